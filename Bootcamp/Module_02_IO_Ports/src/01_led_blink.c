@@ -8,17 +8,11 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 /* Define LED pin using sbit */
 __sbit __at (0x90) LED;  /* P1.0 */
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++) {
-        for (j = 0; j < 120; j++);
-    }
-}
-
 void main(void)
 {
     while (1) {
@@ -11,6 +11,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 __sbit __at (0x90) RED;
 __sbit __at (0x91) YELLOW;
 __sbit __at (0x92) GREEN;
@@ -19,14 +21,6 @@ __sbit __at (0x92) GREEN;
 #define ON  0
 #define OFF 1
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++) {
-        for (j = 0; j < 120; j++);
-    }
-}
-
 void all_off(void)
 {
     RED = OFF;
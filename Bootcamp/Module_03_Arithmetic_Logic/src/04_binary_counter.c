@@ -8,12 +8,7 @@
 
 #include <8052.h>
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
+#include "../../lib/delay.h"
 
 void main(void)
 {
@@ -4,36 +4,19 @@
  *
  * Description: Reusable delay functions
  * Hardware: LED on P1.0
+ *
+ * The delays come from lib/delay.h, which works out its loop counts
+ * from F_CPU at compile time instead of a constant tuned for one
+ * crystal: delay_ms() counts Timer 0 overflows, delay_us() is a
+ * cycle-exact DJNZ loop. Build with -DF_CPU=12000000UL for a 12MHz
+ * board.
  */
 
 #include <8052.h>
 
-__sbit __at (0x90) LED;
-
-/* Microsecond delay (approximate) */
-void delay_us(unsigned int us)
-{
-    while (us--) {
-        /* ~1µs at 12MHz */
-    }
-}
-
-/* Millisecond delay */
-void delay_ms(unsigned int ms)
-{
-    unsigned int i;
-    while (ms--) {
-        for (i = 0; i < 120; i++);
-    }
-}
+#include "../../lib/delay.h"
 
-/* Second delay */
-void delay_sec(unsigned char sec)
-{
-    while (sec--) {
-        delay_ms(1000);
-    }
-}
+__sbit __at (0x90) LED;
 
 void main(void)
 {
@@ -4,45 +4,31 @@
  *
  * Description: Proper button handling with debounce
  * Hardware: Button on P3.2, LED on P1.0
+ *
+ * A contact bounces for a few milliseconds when pressed or released, so
+ * one reading is not enough. Instead of waiting 20ms and reading again
+ * (which stalls the program on every press), lib/button.h samples the
+ * button every 5ms from a timer interrupt and accepts a new level only
+ * after 4 equal samples. The main loop just asks whether a press has
+ * happened and is free to do other work.
  */
 
 #include <8052.h>
 
-__sbit __at (0x90) LED;
-__sbit __at (0xB2) BUTTON;  /* P3.2 (INT0 pin) */
-
-#define DEBOUNCE_MS 20
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i;
-    while (ms--) {
-        for (i = 0; i < 120; i++);
-    }
-}
+#define BUTTON_MASK 0x04        /* P3.2 (INT0 pin) */
+#include "../../lib/button.h"
 
-unsigned char debounce_button(void)
-{
-    if (BUTTON == 0) {           /* Button pressed? */
-        delay_ms(DEBOUNCE_MS);   /* Wait for debounce */
-        if (BUTTON == 0) {       /* Still pressed? */
-            while (BUTTON == 0); /* Wait for release */
-            delay_ms(DEBOUNCE_MS);
-            return 1;            /* Valid press */
-        }
-    }
-    return 0;                    /* No press */
-}
+__sbit __at (0x90) LED;
 
 void main(void)
 {
     unsigned char led_state = 1;  /* OFF initially */
 
-    BUTTON = 1;  /* Configure as input */
     LED = led_state;
+    button_init();
 
     while (1) {
-        if (debounce_button()) {
+        if (button_pressed(BUTTON_MASK)) {
             /* Toggle LED on each button press */
             led_state = !led_state;
             LED = led_state;
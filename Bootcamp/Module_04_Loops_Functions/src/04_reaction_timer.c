@@ -3,58 +3,90 @@
  * Module 04: Loops & Functions
  *
  * Description: Measure reaction time
- * Hardware: Button on P3.2, LEDs on P1
+ * Hardware: Button on P1.1 (T2EX), LEDs on P2
+ *
+ * Counting 10ms delay loops until the button reads low measures the
+ * loop as much as the player, to within 10ms at best. Here Timer 2
+ * latches the button edge in hardware (lib/capture.h): the time from
+ * lighting the LEDs to the press is exact to the machine cycle (about
+ * 1us), and the waits are timed on the same counter, so there are no
+ * loops to calibrate.
  */
 
 #include <8052.h>
 
-__sbit __at (0xB2) BUTTON;
+#include "../../lib/capture.h"
+
+#define TIMEOUT_MS  2000
+
+unsigned int seed = 12345;
 
-void delay_ms(unsigned int ms)
+/* Wait on the Timer 2 count */
+void wait_ms(unsigned int ms)
 {
-    unsigned int i;
-    while (ms--) {
-        for (i = 0; i < 120; i++);
-    }
+    unsigned long t0 = capture_now();
+
+    while (capture_now() - t0 < (unsigned long)ms * CAPTURE_CYC_MS);
 }
 
 unsigned int random_delay(void)
 {
     /* Simple pseudo-random delay 1-5 seconds */
-    static unsigned int seed = 12345;
     seed = seed * 1103515245 + 12345;
     return 1000 + (seed % 4000);  /* 1000-5000 ms */
 }
 
 void main(void)
 {
+    unsigned long start, t;
     unsigned int reaction_time;
-    unsigned int i;
+    __bit early;
 
-    BUTTON = 1;  /* Input */
+    capture_init();
 
     while (1) {
-        /* All LEDs OFF - waiting */
-        P1 = 0xFF;
-        delay_ms(random_delay());
+        /* All LEDs OFF - waiting; forget presses made before now */
+        P2 = 0xFF;
+        while (capture_get(&t));
+        wait_ms(random_delay());
+
+        /* A press while waiting is a false start */
+        early = 0;
+        while (capture_get(&t)) early = 1;
+        if (early) {
+            P2 = 0x55;              /* Alternate LEDs: too soon */
+            wait_ms(2000);
+            continue;
+        }
 
         /* LED ON - Start timing! */
-        P1 = 0x00;
-        reaction_time = 0;
-
-        /* Count until button pressed */
-        while (BUTTON == 1) {
-            delay_ms(10);
-            reaction_time += 10;
-            if (reaction_time > 2000) break;  /* Timeout */
+        P2 = 0x00;
+        start = capture_now();
+
+        /* Wait for the press; its time was latched on the edge */
+        reaction_time = TIMEOUT_MS;
+        while (capture_now() - start < (unsigned long)TIMEOUT_MS * CAPTURE_CYC_MS) {
+            if (capture_get(&t)) {
+                /* Latched before the LEDs lit: also a false start */
+                if ((signed long)(t - start) < 0) {
+                    early = 1;
+                    break;
+                }
+                reaction_time = capture_us(t - start) / 1000;
+                seed ^= (unsigned int)t;    /* Player's timing is random */
+                break;
+            }
+        }
+        if (early) {
+            P2 = 0x55;
+            wait_ms(2000);
+            continue;
         }
 
         /* Display result on LEDs (lower = faster) */
         /* Scale: 0-255 mapped to reaction time */
-        P1 = ~(unsigned char)(reaction_time / 8);
+        P2 = ~(unsigned char)(reaction_time / 8);
 
-        /* Wait for button release and delay */
-        while (BUTTON == 0);
-        delay_ms(2000);
+        wait_ms(2000);
     }
 }
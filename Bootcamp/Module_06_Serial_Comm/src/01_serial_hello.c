@@ -9,6 +9,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 void uart_init(void)
 {
     TMOD = 0x20;    /* Timer 1, Mode 2 (auto-reload) */
@@ -31,13 +33,6 @@ void uart_puts(char *str)
     }
 }
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 void main(void)
 {
     uart_init();
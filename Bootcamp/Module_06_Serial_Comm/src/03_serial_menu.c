@@ -1,95 +1,129 @@
 /*
- * 03_serial_menu.c - Interactive Menu
+ * 03_serial_menu.c - Interactive Command Shell
  * Module 06: Serial Communication
  *
- * Description: Menu-driven LED control via serial
+ * Description: Command-line LED control via serial
  * Hardware: LEDs on P1, Serial connection
+ *
+ * Type a command and press Enter:
+ *   help            List commands
+ *   on / off        All LEDs on / off
+ *   toggle          Invert LEDs
+ *   led 0x5A        Show a value on the LEDs (decimal or hex)
+ *   count [ms]      Binary count 0-15, default 200ms per step
+ *
+ * Commands come from a sorted __code table (lib/shell.h), so adding one
+ * is a table entry, not another switch case. "count" runs a step per
+ * shell_poll() instead of blocking, and Ctrl-C stops it.
  */
 
 #include <8052.h>
 
-void uart_init(void)
-{
-    TMOD = 0x20;
-    TH1 = 0xFD;
-    SCON = 0x50;
-    TR1 = 1;
-}
+#define SYSTICK_NUM_TIMERS 0
+#include "../../lib/systick.h"
 
-void uart_tx(unsigned char c)
+#define SHELL_NUM_CMDS 6
+#include "../../lib/shell.h"
+
+/* LEDs are active low: P1 bit = 0 lights the LED */
+
+unsigned char cmd_on(unsigned char argc)
 {
-    SBUF = c;
-    while (!TI);
-    TI = 0;
+    (void)argc;
+    P1 = 0x00;
+    uart_puts("LEDs ON\r\n");
+    return SHELL_DONE;
 }
 
-unsigned char uart_rx(void)
+unsigned char cmd_off(unsigned char argc)
 {
-    while (!RI);
-    RI = 0;
-    return SBUF;
+    (void)argc;
+    P1 = 0xFF;
+    uart_puts("LEDs OFF\r\n");
+    return SHELL_DONE;
 }
 
-void uart_puts(char *str)
+unsigned char cmd_toggle(unsigned char argc)
 {
-    while (*str) uart_tx(*str++);
+    (void)argc;
+    P1 = ~P1;
+    uart_puts("LEDs Toggled\r\n");
+    return SHELL_DONE;
 }
 
-void show_menu(void)
+unsigned char cmd_led(unsigned char argc)
 {
-    uart_puts("\r\n=== LED Control Menu ===\r\n");
-    uart_puts("1. All LEDs ON\r\n");
-    uart_puts("2. All LEDs OFF\r\n");
-    uart_puts("3. Toggle LEDs\r\n");
-    uart_puts("4. Binary count\r\n");
-    uart_puts("Select (1-4): ");
+    unsigned int v;
+
+    if (argc < 2) {
+        uart_puts("LEDs = ");
+        uart_puthex(~P1);
+        uart_puts("\r\n");
+    } else if (shell_arg_num(1, &v) && v <= 0xFF) {
+        P1 = ~(unsigned char)v;
+    } else {
+        uart_puts("Usage: led <0-255>\r\n");
+    }
+    return SHELL_DONE;
 }
 
-void delay_ms(unsigned int ms)
+/*
+ * Binary count, one step per call
+ * Returns SHELL_BUSY until all 16 values are shown.
+ */
+unsigned char cmd_count(unsigned char argc)
 {
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
+    static unsigned char i;
+    static unsigned int step;
+    static systick_t next;
+
+    if (shell_first) {
+        if (argc < 2) {
+            step = 200;
+        } else if (!shell_arg_num(1, &step) || step == 0) {
+            uart_puts("Usage: count [ms]\r\n");
+            return SHELL_DONE;
+        }
+        uart_puts("Counting... (Ctrl-C to stop)\r\n");
+        i = 0;
+        next = millis();
+    }
+
+    if (!systick_expired(next)) return SHELL_BUSY;
+
+    if (i == 16) {
+        uart_puts("Done!\r\n");
+        return SHELL_DONE;
+    }
+
+    P1 = ~i;
+    i++;
+    next += step;
+    return SHELL_BUSY;
 }
 
+/* Sorted by name for binary search */
+__code shell_cmd_t shell_cmds[SHELL_NUM_CMDS] = {
+    { "count",  cmd_count,  "count [ms]  Binary count on LEDs" },
+    { "help",   shell_help, "List commands" },
+    { "led",    cmd_led,    "led <0-255> Show value on LEDs" },
+    { "off",    cmd_off,    "All LEDs OFF" },
+    { "on",     cmd_on,     "All LEDs ON" },
+    { "toggle", cmd_toggle, "Invert LEDs" }
+};
+
 void main(void)
 {
-    unsigned char choice;
-    unsigned char count = 0;
-    unsigned char i;
+    P1 = 0xFF;  /* All OFF */
 
+    systick_init();
     uart_init();
-    P1 = 0xFF;  /* All OFF */
 
-    while (1) {
-        show_menu();
-        choice = uart_rx();
-        uart_tx(choice);  /* Echo */
-        uart_puts("\r\n");
+    uart_puts("\r\n=== LED Control Shell ===\r\n");
+    uart_puts("Type 'help' for commands\r\n");
+    shell_init();
 
-        switch (choice) {
-            case '1':
-                P1 = 0x00;
-                uart_puts("LEDs ON\r\n");
-                break;
-            case '2':
-                P1 = 0xFF;
-                uart_puts("LEDs OFF\r\n");
-                break;
-            case '3':
-                P1 = ~P1;
-                uart_puts("LEDs Toggled\r\n");
-                break;
-            case '4':
-                uart_puts("Counting...\r\n");
-                for (i = 0; i < 16; i++) {
-                    P1 = ~i;
-                    delay_ms(200);
-                }
-                uart_puts("Done!\r\n");
-                break;
-            default:
-                uart_puts("Invalid choice!\r\n");
-        }
+    while (1) {
+        shell_poll();
     }
 }
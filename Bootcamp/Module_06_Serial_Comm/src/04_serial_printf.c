@@ -4,79 +4,34 @@
  *
  * Description: Send formatted numbers via serial
  * Hardware: Serial connection to PC
+ *
+ * Uses lib/fmt.h instead of SDCC's printf (too big and slow here):
+ *   - FMT(...) macros: formatting resolved at compile time
+ *   - fmt_printf():    familiar format string, parsed at run time
  */
 
 #include <8052.h>
+#include "../../lib/uart.h"
+#include "../../lib/delay.h"
 
-void uart_init(void)
-{
-    TMOD = 0x20;
-    TH1 = 0xFD;
-    SCON = 0x50;
-    TR1 = 1;
-}
-
-void uart_tx(unsigned char c)
-{
-    SBUF = c;
-    while (!TI);
-    TI = 0;
-}
-
-void uart_puts(char *str)
-{
-    while (*str) uart_tx(*str++);
-}
-
-/* Send unsigned char as decimal */
-void uart_putnum(unsigned char num)
-{
-    unsigned char hundreds, tens, ones;
-
-    hundreds = num / 100;
-    tens = (num / 10) % 10;
-    ones = num % 10;
-
-    if (hundreds > 0) uart_tx('0' + hundreds);
-    if (hundreds > 0 || tens > 0) uart_tx('0' + tens);
-    uart_tx('0' + ones);
-}
-
-/* Send unsigned char as hex */
-void uart_puthex(unsigned char num)
-{
-    unsigned char nibble;
-
-    uart_puts("0x");
-
-    nibble = (num >> 4) & 0x0F;
-    uart_tx(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
-
-    nibble = num & 0x0F;
-    uart_tx(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
+#define FMT_SINK uart_tx    /* Fixed sink: direct calls to uart_tx */
+#include "../../lib/fmt.h"
 
 void main(void)
 {
     unsigned char counter = 0;
 
     uart_init();
-    uart_puts("Number Display Demo\r\n");
-    uart_puts("===================\r\n\r\n");
+    fmt_puts("Number Display Demo\r\n");
+    fmt_puts("===================\r\n\r\n");
 
     while (1) {
-        uart_puts("Counter: ");
-        uart_putnum(counter);
-        uart_puts(" (");
-        uart_puthex(counter);
-        uart_puts(")\r\n");
+        /* Compile-time: one direct call per item */
+        FMT(F_STR("Counter: "), F_UB(counter),
+            F_STR(" (0x"), F_XBW(counter, 2), F_STR(")\r\n"));
+
+        /* Run-time: same output from a format string */
+        fmt_printf("Counter: %bu (0x%02bx)\r\n", (char)counter, (char)counter);
 
         counter++;
         delay_ms(500);
@@ -0,0 +1,139 @@
+/*
+ * 05_numfmt_benchmark.c - Number Conversion Timing
+ * Module 06: Serial Communication
+ *
+ * Description: Compare lib/numfmt.h with the /10 %10 loops it replaced
+ * Hardware: Serial connection to PC (9600 baud)
+ *
+ * Each routine converts its worst-case value (the most digits) into a
+ * RAM buffer RUNS times; the average in machine cycles is sent over the
+ * serial port, one line per routine:
+ *   u8   255         old  xxx  numfmt  xxx
+ * The old routines are copies of the previous uart_putnum()/lcd_putint()
+ * and the calculator's long loop, writing to RAM instead of a device so
+ * only the conversion is timed.
+ *
+ * Timing comes from the Timer 2 system tick (systick_snapshot), so it is
+ * exact to one machine cycle. The figures depend on the SDCC version and
+ * its library (_divuint, _modulong, ...): run it again after an upgrade.
+ */
+
+#include <8052.h>
+
+#define SYSTICK_NUM_TIMERS 0
+#include "../../lib/systick.h"
+#include "../../lib/uart.h"
+
+#define RUNS    16
+
+char out[12];
+volatile unsigned char v8;
+volatile unsigned int v16;
+volatile unsigned long v32;
+
+/* Previous uart_putnum(): three digits by / and % */
+void old_u8(void)
+{
+    unsigned char num = v8;
+    unsigned char i = 0;
+
+    if (num >= 100) out[i++] = '0' + num / 100;
+    if (num >= 10) out[i++] = '0' + (num / 10) % 10;
+    out[i++] = '0' + num % 10;
+    out[i] = '\0';
+}
+
+/* Previous lcd_putint(): % 10, / 10 loop */
+void old_u16(void)
+{
+    unsigned int num = v16;
+    signed char i = 4;
+
+    out[5] = '\0';
+    do {
+        out[i--] = '0' + (num % 10);
+        num /= 10;
+    } while (num > 0 && i >= 0);
+}
+
+/* Previous calculator lcd_putnum(long): same loop on 32 bits */
+void old_u32(void)
+{
+    unsigned long num = v32;
+    signed char i = 10;
+
+    out[11] = '\0';
+    do {
+        out[i--] = '0' + (num % 10);
+        num /= 10;
+    } while (num > 0 && i >= 0);
+}
+
+void new_u8(void)  { numfmt_u8(v8, 0, ' '); }
+void new_u16(void) { numfmt_u16(v16, 0, ' '); }
+void new_u32(void) { numfmt_u32(v32, 0, ' '); }
+
+/*
+ * Average cost of one call
+ *
+ * @param fn: Routine to time
+ * @return: Machine cycles per call
+ */
+unsigned long measure(void (*fn)(void))
+{
+    unsigned char i;
+    systick_t ms0;
+    unsigned int cnt0;
+    unsigned long cycles;
+
+    systick_snapshot();
+    ms0 = systick_snap_ms;
+    cnt0 = systick_snap_cnt;
+
+    for (i = 0; i < RUNS; i++) fn();
+
+    systick_snapshot();
+    cycles = (unsigned long)(systick_t)(systick_snap_ms - ms0) * SYSTICK_PERIOD
+           + (signed int)(systick_snap_cnt - cnt0);
+    return cycles / RUNS;
+}
+
+/* Empty call, subtracted from every figure */
+void nothing(void) { }
+
+void report(char *name, void (*old)(void), void (*nf)(void), unsigned long base)
+{
+    unsigned long a = measure(old) - base;
+    unsigned long b = measure(nf) - base;
+
+    uart_puts(name);
+    uart_puts("  old ");
+    uart_puts(numfmt_u32(a, 6, ' '));
+    uart_puts("  numfmt ");
+    uart_puts(numfmt_u32(b, 6, ' '));
+    uart_puts("\r\n");
+}
+
+void main(void)
+{
+    unsigned long base;
+
+    systick_init();
+    uart_init();
+
+    v8 = 255;
+    v16 = 65535;
+    v32 = 4294967295UL;
+
+    while (1) {
+        base = measure(nothing);
+
+        uart_puts("Cycles per conversion (worst case)\r\n");
+        report("u8   255       ", old_u8, new_u8, base);
+        report("u16  65535     ", old_u16, new_u16, base);
+        report("u32  4294967295", old_u32, new_u32, base);
+        uart_puts("\r\n");
+
+        systick_wait(5000);
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * 06_fmt_benchmark.c - Formatted Output Cost
+ * Module 06: Serial Communication
+ *
+ * Description: Time the line of 04_serial_printf.c written three ways
+ * Hardware: Serial connection to PC (9600 baud)
+ *
+ *   "Counter: 200 (0xC8)\r\n" from
+ *     hand   sink_puts() + numfmt calls, as written before fmt.h
+ *     FMT    FMT(F_STR(...), F_UB(...), ...)
+ *     printf fmt_printf("Counter: %bu (0x%02bx)\r\n", ...)
+ *
+ * hand and FMT use the same 8-bit conversions (numfmt_u8/numfmt_hex8);
+ * fmt_printf() has one conversion path for all sizes, which is part of
+ * its cost.
+ *
+ * The characters go to a RAM buffer (the fixed FMT_SINK), so only the
+ * formatting is timed, not the serial port. Average machine cycles per
+ * line are sent over the serial port.
+ *
+ * Code size: build once per variant and compare the code size SDCC
+ * reports in build/06_fmt_benchmark.mem:
+ *   sdcc -mmcs51 -DBENCH_ONLY=0 ...    none (baseline)
+ *   sdcc -mmcs51 -DBENCH_ONLY=1 ...    hand only
+ *   sdcc -mmcs51 -DBENCH_ONLY=2 ...    FMT only (FMT_NO_PRINTF)
+ *   sdcc -mmcs51 -DBENCH_ONLY=3 ...    fmt_printf only
+ * The difference from the baseline is what each variant costs.
+ *
+ * Timing comes from the Timer 2 system tick (systick_snapshot), so it is
+ * exact to one machine cycle. The figures depend on the SDCC version.
+ */
+
+#include <8052.h>
+
+#define SYSTICK_NUM_TIMERS 0
+#include "../../lib/systick.h"
+#include "../../lib/uart.h"
+
+#ifndef BENCH_ONLY
+#define BENCH_ONLY  4           /* All three, timed */
+#endif
+
+#define RUNS    16
+
+char out[32];
+unsigned char out_len;
+
+/* RAM sink: keeps the last line */
+void sink_put(unsigned char c)
+{
+    out[out_len] = c;
+    out_len = (out_len + 1) & 31;
+}
+
+void sink_puts(char *s)
+{
+    while (*s) sink_put(*s++);
+}
+
+#if BENCH_ONLY == 2
+#define FMT_NO_PRINTF
+#endif
+#if BENCH_ONLY >= 2
+#define FMT_SINK sink_put
+#include "../../lib/fmt.h"
+#endif
+
+volatile unsigned char counter;
+
+#if BENCH_ONLY == 1 || BENCH_ONLY == 4
+void line_hand(void)
+{
+    sink_puts("Counter: ");
+    sink_puts(numfmt_u8(counter, 0, ' '));
+    sink_puts(" (0x");
+    sink_puts(numfmt_hex8(counter, 2, '0'));
+    sink_puts(")\r\n");
+}
+#endif
+
+#if BENCH_ONLY == 2 || BENCH_ONLY == 4
+void line_fmt(void)
+{
+    FMT(F_STR("Counter: "), F_UB(counter),
+        F_STR(" (0x"), F_XBW(counter, 2), F_STR(")\r\n"));
+}
+#endif
+
+#if BENCH_ONLY == 3 || BENCH_ONLY == 4
+void line_printf(void)
+{
+    fmt_printf("Counter: %bu (0x%02bx)\r\n", (char)counter, (char)counter);
+}
+#endif
+
+/*
+ * Average cost of one call
+ *
+ * @param fn: Routine to time
+ * @return: Machine cycles per call
+ */
+unsigned long measure(void (*fn)(void))
+{
+    unsigned char i;
+    systick_t ms0;
+    unsigned int cnt0;
+    unsigned long cycles;
+
+    systick_snapshot();
+    ms0 = systick_snap_ms;
+    cnt0 = systick_snap_cnt;
+
+    for (i = 0; i < RUNS; i++) fn();
+
+    systick_snapshot();
+    cycles = (unsigned long)(systick_t)(systick_snap_ms - ms0) * SYSTICK_PERIOD
+           + (signed int)(systick_snap_cnt - cnt0);
+    return cycles / RUNS;
+}
+
+/* Empty call, subtracted from every figure */
+void nothing(void) { }
+
+void report(char *name, void (*fn)(void), unsigned long base)
+{
+    uart_puts(name);
+    uart_puts(numfmt_u32(measure(fn) - base, 6, ' '));
+    uart_puts(" cycles\r\n");
+}
+
+void main(void)
+{
+    unsigned long base;
+
+    systick_init();
+    uart_init();
+    counter = 200;
+
+    while (1) {
+        base = measure(nothing);
+
+        uart_puts("Cycles per line\r\n");
+#if BENCH_ONLY == 1 || BENCH_ONLY == 4
+        report("hand   ", line_hand, base);
+#endif
+#if BENCH_ONLY == 2 || BENCH_ONLY == 4
+        report("FMT    ", line_fmt, base);
+#endif
+#if BENCH_ONLY == 3 || BENCH_ONLY == 4
+        report("printf ", line_printf, base);
+#endif
+        uart_puts("\r\n");
+
+        systick_wait(5000);
+    }
+}
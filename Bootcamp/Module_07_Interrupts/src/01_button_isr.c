@@ -4,45 +4,32 @@
  *
  * Description: Toggle LED on button press using INT0
  * Hardware: Button on P3.2 (INT0), LED on P1.0
+ *
+ * The INT0 ISR stamps each falling edge with the system tick and queues
+ * it (lib/extint.h); bounce is rejected by the time between stamps, so
+ * the main loop never waits and no press is lost while it is busy.
+ * Timer 2 runs the tick (lib/systick.h).
  */
 
 #include <8052.h>
 
-/* Volatile - shared between ISR and main */
-volatile unsigned char button_pressed = 0;
-
-/* External INT0 ISR */
-void ext0_isr(void) __interrupt(0)
-{
-    button_pressed = 1;  /* Set flag for main loop */
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
+#define EXTINT_INT0
+#define EXTINT_WINDOW_MS 20
+#include "../../lib/extint.h"
 
 void main(void)
 {
-    /* Configure INT0 */
-    IT0 = 1;    /* Edge triggered (falling edge) */
-    EX0 = 1;    /* Enable External Interrupt 0 */
-    EA = 1;     /* Global interrupt enable */
+    extint_event_t ev;
 
     P1 = 0xFF;  /* All LEDs OFF initially */
 
-    while (1) {
-        if (button_pressed) {
-            /* Debounce delay */
-            delay_ms(50);
+    systick_init();
+    extint_init();  /* Falling edge, INT0 enabled */
 
-            /* Toggle LED on P1.0 */
+    while (1) {
+        /* One toggle per debounced press, in the order they came */
+        while (extint_get(&ev)) {
             P1_0 = !P1_0;
-
-            /* Clear flag */
-            button_pressed = 0;
         }
 
         /* Main loop can do other work here */
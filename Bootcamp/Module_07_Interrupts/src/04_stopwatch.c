@@ -1,106 +1,129 @@
 /*
- * 04_stopwatch.c - Simple Stopwatch
+ * 04_stopwatch.c - Lap Stopwatch
  * Module 07: Interrupts
  *
- * Description: Stopwatch with start/stop button
- * Hardware: Button on P3.2 (INT0), LEDs on P1
- * Display: Binary seconds on P1 (0-255)
+ * Description: Stopwatch with lap/split times to the microsecond
+ * Hardware: Start/Lap button on P1.1 (T2EX), Stop button on P3.2 (INT0),
+ *           LEDs on P2, serial connection to PC (9600 baud)
+ * Display: Binary seconds on P2 (0-255), times over serial
+ *
+ * Timer 2 latches the button edge in hardware (lib/capture.h), so the
+ * times do not depend on when the ISR or the main loop got to it. The
+ * first Start/Lap press starts a run, each further one prints its lap
+ * and split:
+ *   lap 2  1.302718  split 3.914402
+ * Stop ends the run at the Stop press: the INT0 ISR stamps that edge on
+ * the same count, a few cycles of interrupt latency after it, and the
+ * run time printed is from start to that stamp.
  */
 
 #include <8052.h>
 
+#include "../../lib/capture.h"
+#include "../../lib/numfmt.h"
+#include "../../lib/uart.h"
+
 /* Stopwatch state */
-volatile unsigned char running = 0;
-volatile unsigned char seconds = 0;
-volatile unsigned char tick_count = 0;
+unsigned char running = 0;
+unsigned char laps = 0;
+unsigned char seconds = 0;
 
-/* Button press flag */
-volatile unsigned char button_flag = 0;
+/* Stop edge, stamped by the INT0 ISR */
+volatile __bit stop_seen = 0;
+unsigned long stop_t;
 
-/* External INT0 - Start/Stop button */
-void ext0_isr(void) __interrupt(0)
+/*
+ * INT0 ISR - Stop button falling edge
+ * Reads the 32-bit count with capture.h's _CAPTURE_READ(), inline:
+ * capture_now() is also called by the main loop and SDCC functions are
+ * not reentrant. Same priority as the Timer 2 ISR, so the count cannot
+ * change under it. Only the first edge is kept until the main loop
+ * takes it, so bounce does not move the stamp.
+ */
+void stop_isr(void) __interrupt(0)
 {
-    button_flag = 1;
+    if (stop_seen) return;
+    _CAPTURE_READ(stop_t);
+    stop_seen = 1;
 }
 
-/* Timer 0 - 10ms tick */
-void timer0_isr(void) __interrupt(1)
+/* Print microseconds as seconds, e.g. " 3.914402" */
+void put_time(unsigned long us)
 {
-    /* Reload for 10ms @ 12MHz */
-    TH0 = 0xD8;
-    TL0 = 0xF0;
+    uart_puts(numfmt_u32(us / 1000000UL, 2, ' '));
+    uart_tx('.');
+    uart_puts(numfmt_u32(us % 1000000UL, 6, '0'));
+}
 
+/* End the run at the Stop stamp; a stamp while stopped is dropped */
+void take_stop(void)
+{
     if (running) {
-        tick_count++;
-        if (tick_count >= 100) {  /* 100 x 10ms = 1 second */
-            tick_count = 0;
-            seconds++;
-        }
+        running = 0;
+        seconds = capture_us(capture_split(stop_t)) / 1000000UL;
+        uart_puts("stop ");
+        put_time(capture_us(capture_split(stop_t)));
+        uart_puts("\r\n");
     }
+    stop_seen = 0;
 }
 
-void delay_ms(unsigned int ms)
+void main(void)
 {
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
+    unsigned long t;
+    unsigned char out;
 
-void system_init(void)
-{
-    /* Timer 0: Mode 1, 16-bit */
-    TMOD = 0x01;
-    TH0 = 0xD8;     /* 10ms delay value */
-    TL0 = 0xF0;
+    P2 = 0xFF;      /* Display OFF */
 
-    /* INT0: Edge triggered */
-    IT0 = 1;
+    uart_init();
+    capture_init();
 
-    /* Enable interrupts */
-    ET0 = 1;        /* Timer 0 interrupt */
-    EX0 = 1;        /* External INT0 */
-    EA = 1;         /* Global enable */
-
-    /* Start Timer 0 */
-    TR0 = 1;
-}
-
-void main(void)
-{
-    system_init();
+    /* Stop button: falling edge, stamped by stop_isr() */
+    IT0 = 1;
+    IE0 = 0;
+    EX0 = 1;
 
-    P1 = 0xFF;      /* Display OFF */
-    seconds = 0;
-    running = 0;
+    uart_puts("Lap stopwatch\r\n");
 
     while (1) {
-        /* Handle button press */
-        if (button_flag) {
-            delay_ms(50);  /* Debounce */
-            button_flag = 0;
-
-            /* Toggle running state */
-            running = !running;
-
-            /* Reset on start */
-            if (running) {
-                seconds = 0;
-                tick_count = 0;
+        /* Start/Lap presses, each at its captured edge */
+        while (capture_get(&t)) {
+            /* A Stop before this press comes first */
+            if (stop_seen && (signed long)(t - stop_t) > 0) take_stop();
+
+            if (!running) {
+                /* Reset on start */
+                capture_start(t);
+                laps = 0;
+                running = 1;
+                uart_puts("start\r\n");
+            } else {
+                laps++;
+                uart_puts("lap ");
+                uart_puts(numfmt_u8(laps, 1, ' '));
+                uart_tx(' ');
+                put_time(capture_us(capture_lap(t)));
+                uart_puts("  split ");
+                put_time(capture_us(capture_split(t)));
+                uart_puts("\r\n");
             }
         }
 
+        /* Stop: the run ends at the Stop edge */
+        if (stop_seen) take_stop();
+
+        if (running) {
+            seconds = capture_us(capture_split(capture_now())) / 1000000UL;
+        }
+
         /* Update display (inverted for common cathode LEDs) */
-        P1 = ~seconds;
+        out = ~seconds;
 
-        /* LED P1.7 shows running status */
+        /* LED P2.7 shows running status */
         /* Blinks when stopped, steady when running */
-        if (!running) {
-            static unsigned int blink = 0;
-            blink++;
-            if (blink > 5000) {
-                blink = 0;
-                P1_7 = !P1_7;
-            }
+        if (!running && (capture_now() & 0x40000UL)) {
+            out ^= 0x80;
         }
+        P2 = out;
     }
 }
@@ -8,6 +8,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 /* 7-segment patterns for 0-9 (Common Cathode) */
 /* Bit order: dp g f e d c b a */
 __code unsigned char SEGMENT[] = {
@@ -23,13 +25,6 @@ __code unsigned char SEGMENT[] = {
     0x6F    /* 9: a b c d   f g  */
 };
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 void main(void)
 {
     unsigned char digit = 0;
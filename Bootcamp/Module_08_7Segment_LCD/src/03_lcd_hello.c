@@ -9,6 +9,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 /* LCD Pin Definitions */
 __sbit __at (0xA0) LCD_RS;    /* P2.0 - Register Select */
 __sbit __at (0xA1) LCD_EN;    /* P2.1 - Enable */
@@ -23,18 +25,6 @@ __sbit __at (0xA1) LCD_EN;    /* P2.1 - Enable */
 #define LCD_LINE1       0x80
 #define LCD_LINE2       0xC0
 
-void delay_us(unsigned int us)
-{
-    while (us--);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 /* Send 4-bit nibble to LCD */
 void lcd_nibble(unsigned char nibble)
 {
@@ -8,6 +8,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 /* LCD Pin Definitions */
 __sbit __at (0xA0) LCD_RS;    /* P2.0 */
 __sbit __at (0xA1) LCD_EN;    /* P2.1 */
@@ -21,18 +23,6 @@ __sbit __at (0xA1) LCD_EN;    /* P2.1 */
 #define LCD_LINE1       0x80
 #define LCD_LINE2       0xC0
 
-void delay_us(unsigned int us)
-{
-    while (us--);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 void lcd_nibble(unsigned char nibble)
 {
     LCD_DATA = (LCD_DATA & 0x0F) | (nibble & 0xF0);
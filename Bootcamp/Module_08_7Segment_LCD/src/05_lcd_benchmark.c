@@ -0,0 +1,92 @@
+/*
+ * 05_lcd_benchmark.c - LCD Update Timing
+ * Module 08: 7-Segment & LCD
+ *
+ * Description: Measure how long a full 16x2 screen update takes
+ * Hardware: LCD in 4-bit mode on P2 (RW on P2.2 for busy-flag mode)
+ *
+ * Build twice and compare the numbers shown on line 2:
+ *   make                               fixed delays (RW tied to GND)
+ *   sdcc -mmcs51 -DLCD_USE_BUSY ...    busy-flag polling (RW on P2.2)
+ *   sdcc -mmcs51 -DLCD_8BIT ...        8-bit bus (D0-D7 on P1), either mode
+ *   sdcc -mmcs51 -DLCD_DATA_DEDICATED -DLCD_DATA=P1 -DLCD_RS=P2_0 \
+ *        -DLCD_EN=P2_1 ...             4-bit bus alone on P1.4-7
+ *                                      (add -DLCD_RW=P2_2 with busy flag)
+ * Divide by 34 (32 characters, 2 cursor moves) for one lcd_data().
+ *
+ * Timing comes from the Timer 2 system tick (systick_snapshot), so it is
+ * exact to one machine cycle and includes everything the CPU waits for.
+ */
+
+#include <8052.h>
+
+#define SYSTICK_NUM_TIMERS 0
+#include "../../lib/systick.h"
+#include "../../lib/lcd.h"
+
+#define RUNS    8
+
+__code char TEXT[] = "0123456789ABCDEF";
+
+/* One full screen: 2 cursor moves + 32 characters */
+void write_screen(void)
+{
+    unsigned char i;
+
+    lcd_goto(0, 0);
+    for (i = 0; i < 16; i++) lcd_data(TEXT[i]);
+    lcd_goto(1, 0);
+    for (i = 0; i < 16; i++) lcd_data(TEXT[15 - i]);
+}
+
+/*
+ * Average cost of write_screen()
+ *
+ * @return: Machine cycles per screen
+ */
+unsigned long measure(void)
+{
+    unsigned char i;
+    systick_t ms0;
+    unsigned int cnt0;
+    unsigned long cycles;
+
+    systick_snapshot();
+    ms0 = systick_snap_ms;
+    cnt0 = systick_snap_cnt;
+
+    for (i = 0; i < RUNS; i++) write_screen();
+
+    systick_snapshot();
+    cycles = (unsigned long)(systick_t)(systick_snap_ms - ms0) * SYSTICK_PERIOD
+           + (signed int)(systick_snap_cnt - cnt0);
+    return cycles / RUNS;
+}
+
+void main(void)
+{
+    unsigned long cycles;
+
+    systick_init();
+    lcd_init();
+
+    while (1) {
+        cycles = measure();
+
+        lcd_clear();
+        lcd_goto(0, 0);
+#ifdef LCD_USE_BUSY
+        lcd_puts(lcd_busy_ok ? "Busy flag" : "No busy flag");
+#else
+        lcd_puts("Fixed delay");
+#endif
+        lcd_goto(1, 0);
+        lcd_puts(numfmt_u32(cycles * 12000UL / (F_CPU / 1000UL), 5, ' '));
+        lcd_puts(" us/scr");
+#ifdef LCD_8BIT
+        lcd_puts(" 8b");
+#endif
+
+        systick_wait(2000);
+    }
+}
@@ -9,6 +9,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 /* ADC0804 Control Pins */
 __sbit __at (0xB5) ADC_CS;    /* P3.5 - Chip Select */
 __sbit __at (0xB6) ADC_RD;    /* P3.6 - Read */
@@ -17,18 +19,6 @@ __sbit __at (0xB2) ADC_INTR;  /* P3.2 - Interrupt (conversion done) */
 
 #define ADC_DATA P1           /* Data bus */
 
-void delay_us(unsigned int us)
-{
-    while (us--);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 /* Start ADC conversion */
 void adc_start(void)
 {
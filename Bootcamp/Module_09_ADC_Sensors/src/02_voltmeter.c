@@ -8,6 +8,25 @@
 
 #include <8052.h>
 
+/*
+ * Build with -DTELEMETRY_BINARY to stream raw ADC samples as framed
+ * binary telemetry (lib/telemetry.h) instead of text. Decode on the PC:
+ *   stty -F /dev/ttyUSB0 9600 raw; python3 tools/tlm_decode.py < /dev/ttyUSB0
+ */
+#ifdef TELEMETRY_BINARY
+#define UART_BUFFERED
+#define UART_TX_SIZE    64
+#endif
+
+#include "../../lib/uart.h"
+#include "../../lib/delay.h"
+
+#ifdef TELEMETRY_BINARY
+#define TLM_MAX_PAYLOAD 34      /* Channel + count + 32 samples */
+#include "../../lib/telemetry.h"
+#define SAMPLE_MS       10
+#endif
+
 /* ADC0804 Control Pins */
 __sbit __at (0xB5) ADC_CS;
 __sbit __at (0xB6) ADC_RD;
@@ -15,39 +34,6 @@ __sbit __at (0xB7) ADC_WR;
 __sbit __at (0xB2) ADC_INTR;
 #define ADC_DATA P1
 
-void delay_us(unsigned int us)
-{
-    while (us--);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
-/* UART Functions */
-void uart_init(void)
-{
-    TMOD = 0x20;
-    TH1 = 0xFD;
-    SCON = 0x50;
-    TR1 = 1;
-}
-
-void uart_tx(unsigned char c)
-{
-    SBUF = c;
-    while (!TI);
-    TI = 0;
-}
-
-void uart_puts(char *str)
-{
-    while (*str) uart_tx(*str++);
-}
-
 /* ADC Functions */
 unsigned char adc_convert(void)
 {
@@ -102,6 +88,15 @@ void main(void)
     ADC_WR = 1;
     uart_init();
 
+#ifdef TELEMETRY_BINARY
+    /* 100 samples/s, one frame per 32 samples (38 bytes on the wire) */
+    tlm_batch_begin(TLM_BATCH8, 0);
+    while (1) {
+        tlm_batch_add(adc_convert());
+        delay_ms(SAMPLE_MS);
+    }
+#endif
+
     uart_puts("Digital Voltmeter\r\n");
     uart_puts("================\r\n\r\n");
 
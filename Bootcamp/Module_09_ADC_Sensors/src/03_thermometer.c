@@ -9,6 +9,8 @@
 
 #include <8052.h>
 
+#include "../../lib/delay.h"
+
 /* ADC0804 Control Pins */
 __sbit __at (0xB5) ADC_CS;
 __sbit __at (0xB6) ADC_RD;
@@ -16,18 +18,6 @@ __sbit __at (0xB7) ADC_WR;
 __sbit __at (0xB2) ADC_INTR;
 #define ADC_DATA P1
 
-void delay_us(unsigned int us)
-{
-    while (us--);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 /* UART Functions */
 void uart_init(void)
 {
@@ -9,27 +9,22 @@
 
 #include <8052.h>
 
+/* Buttons on P3.2 (speed) and P3.3 (direction), debounced by Timer 0 */
+#define BTN_SPEED   0x04
+#define BTN_DIR     0x08
+#define BUTTON_MASK (BTN_SPEED | BTN_DIR)
+#include "../../lib/button.h"
+
 /* Motor control pins */
 __sbit __at (0x90) MOTOR_EN;   /* P1.0 - Enable (PWM) */
 __sbit __at (0x91) MOTOR_IN1;  /* P1.1 - Direction 1 */
 __sbit __at (0x92) MOTOR_IN2;  /* P1.2 - Direction 2 */
 
-/* Button inputs */
-__sbit __at (0xB2) BTN_SPEED;  /* P3.2 - Speed button */
-__sbit __at (0xB3) BTN_DIR;    /* P3.3 - Direction button */
-
 /* PWM variables */
 unsigned char pwm_duty = 50;   /* 0-100% */
 unsigned char pwm_counter = 0;
 unsigned char direction = 1;   /* 1=forward, 0=reverse */
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 /* Set motor direction */
 void motor_set_direction(unsigned char dir)
 {
@@ -66,13 +61,12 @@ void pwm_update(void)
 void main(void)
 {
     unsigned int i;
-    unsigned char speed_pressed = 0;
-    unsigned char dir_pressed = 0;
 
     /* Initialize */
     motor_stop();
     motor_set_direction(direction);
     pwm_duty = 50;
+    button_init();
 
     while (1) {
         /* PWM loop - run many times for smooth PWM */
@@ -80,26 +74,16 @@ void main(void)
             pwm_update();
         }
 
-        /* Check speed button */
-        if (BTN_SPEED == 0 && !speed_pressed) {
-            speed_pressed = 1;
-            delay_ms(20);  /* Debounce */
-
-            /* Cycle through speeds: 25, 50, 75, 100 */
+        /* Speed button: cycle through 25, 50, 75, 100 */
+        if (button_pressed(BTN_SPEED)) {
             pwm_duty += 25;
             if (pwm_duty > 100) pwm_duty = 25;
         }
-        if (BTN_SPEED == 1) speed_pressed = 0;
-
-        /* Check direction button */
-        if (BTN_DIR == 0 && !dir_pressed) {
-            dir_pressed = 1;
-            delay_ms(20);  /* Debounce */
 
-            /* Toggle direction */
+        /* Direction button: toggle */
+        if (button_pressed(BTN_DIR)) {
             direction = !direction;
             motor_set_direction(direction);
         }
-        if (BTN_DIR == 1) dir_pressed = 0;
     }
 }
@@ -10,12 +10,14 @@
 
 #include <8052.h>
 
+/* Direction button on P3.2, debounced by Timer 0 */
+#define BTN_DIR     0x04
+#define BUTTON_MASK BTN_DIR
+#include "../../lib/button.h"
+
 /* Stepper coils on P1.0-P1.3 */
 #define STEPPER_PORT P1
 
-/* Direction button */
-__sbit __at (0xB2) BTN_DIR;
-
 /* Step sequences */
 
 /* Full step - Wave drive (one coil at a time) */
@@ -51,13 +53,6 @@ unsigned char step_index = 0;
 unsigned char direction = 1;  /* 1=CW, 0=CCW */
 unsigned char step_mode = 0;  /* 0=full, 1=half */
 
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
 /* Take one step */
 void stepper_step(void)
 {
@@ -99,25 +94,22 @@ void stepper_rotate(unsigned int steps, unsigned int delay)
 
 void main(void)
 {
-    unsigned char btn_pressed = 0;
     unsigned int step_delay = 10;  /* ms between steps */
 
     /* Initialize */
     STEPPER_PORT = 0x00;
     direction = 1;
     step_mode = 0;  /* Full step */
+    button_init();
 
     while (1) {
         /* Take one step */
         stepper_step();
         delay_ms(step_delay);
 
-        /* Check direction button */
-        if (BTN_DIR == 0 && !btn_pressed) {
-            btn_pressed = 1;
-            delay_ms(20);  /* Debounce */
+        /* Direction button (a press during the step delay is kept) */
+        if (button_pressed(BTN_DIR)) {
             direction = !direction;
         }
-        if (BTN_DIR == 1) btn_pressed = 0;
     }
 }
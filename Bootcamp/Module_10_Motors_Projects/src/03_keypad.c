@@ -5,43 +5,22 @@
  * Description: Scan 4x4 keypad and send key via serial
  * Hardware: Keypad on P2 (rows P2.0-3, cols P2.4-7)
  *           Serial connection to PC
+ *
+ * The keypad is scanned in the background (lib/keypad.h); the main loop
+ * only pops events, so holding a key never stalls it. Keys pressed
+ * together are all reported, and the keys held are listed; a pattern the
+ * matrix cannot resolve (ghosting) is flagged instead.
  */
 
 #include <8052.h>
 
-#define KEYPAD_PORT P2
-
-/* Row pins (output) */
-__sbit __at (0xA0) ROW0;
-__sbit __at (0xA1) ROW1;
-__sbit __at (0xA2) ROW2;
-__sbit __at (0xA3) ROW3;
-
-/* Column pins (input) */
-__sbit __at (0xA4) COL0;
-__sbit __at (0xA5) COL1;
-__sbit __at (0xA6) COL2;
-__sbit __at (0xA7) COL3;
-
-/* Keypad layout */
-__code char KEYMAP[4][4] = {
-    {'1', '2', '3', 'A'},
-    {'4', '5', '6', 'B'},
-    {'7', '8', '9', 'C'},
-    {'*', '0', '#', 'D'}
-};
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
+/* Keypad on P2 (lib/keypad.h defaults), scanned by the Timer 0 ISR */
+#include "../../lib/keypad.h"
 
 /* UART Functions */
 void uart_init(void)
 {
-    TMOD = 0x20;
+    TMOD = (TMOD & 0x0F) | 0x20;  /* Timer 1, Mode 2 - Timer 0 is the keypad */
     TH1 = 0xFD;
     SCON = 0x50;
     TR1 = 1;
@@ -59,77 +38,53 @@ void uart_puts(char *str)
     while (*str) uart_tx(*str++);
 }
 
-/* Scan keypad and return key char (0 if none) */
-char keypad_scan(void)
+/* List the keys held now, e.g. "[1 5 9]" */
+void show_held(void)
 {
-    unsigned char row;
-    char key = 0;
-
-    for (row = 0; row < 4; row++) {
-        /* Set all rows high */
-        KEYPAD_PORT = 0xFF;
-
-        /* Set current row low */
-        KEYPAD_PORT = ~(1 << row);
-
-        /* Small delay for settling */
-        delay_ms(1);
-
-        /* Check columns */
-        if (COL0 == 0) { key = KEYMAP[row][0]; break; }
-        if (COL1 == 0) { key = KEYMAP[row][1]; break; }
-        if (COL2 == 0) { key = KEYMAP[row][2]; break; }
-        if (COL3 == 0) { key = KEYMAP[row][3]; break; }
+    unsigned int held = keypad_held();
+    unsigned char k;
+
+    uart_tx('[');
+    for (k = 0; k < 16; k++) {
+        if (held & 1) {
+            uart_tx(KEYPAD_KEYS[k]);
+            if (held > 1) uart_tx(' ');
+        }
+        held >>= 1;
     }
-
-    /* Reset port */
-    KEYPAD_PORT = 0xFF;
-
-    return key;
-}
-
-/* Wait for key press with debounce */
-char keypad_getkey(void)
-{
-    char key1, key2;
-
-    /* Wait for key press */
-    do {
-        key1 = keypad_scan();
-    } while (key1 == 0);
-
-    /* Debounce */
-    delay_ms(20);
-
-    /* Verify */
-    key2 = keypad_scan();
-    if (key1 != key2) return 0;
-
-    /* Wait for key release */
-    while (keypad_scan() != 0);
-    delay_ms(20);
-
-    return key1;
+    uart_puts("]\r\n");
 }
 
 void main(void)
 {
-    char key;
+    unsigned char e;
 
     uart_init();
-    KEYPAD_PORT = 0xFF;  /* All high (pull-ups) */
+    keypad_init();
 
     uart_puts("4x4 Keypad Test\r\n");
     uart_puts("===============\r\n\r\n");
     uart_puts("Press any key...\r\n");
 
     while (1) {
-        key = keypad_getkey();
+        /* Every press, release and auto-repeat, in order */
+        e = keypad_get();
+        if (e == 0) continue;
+
+        if (e == KEYPAD_GHOST) {
+            uart_puts("Ambiguous keys - release some\r\n");
+            continue;
+        }
 
-        if (key != 0) {
-            uart_puts("Key: ");
-            uart_tx(key);
-            uart_puts("\r\n");
+        uart_puts("Key: ");
+        uart_tx(keypad_char(e));
+        if (KEYPAD_TYPE(e) == KEYPAD_PRESS) {
+            uart_puts(" down ");
+            show_held();
+        } else if (KEYPAD_TYPE(e) == KEYPAD_RELEASE) {
+            uart_puts(" up\r\n");
+        } else {
+            uart_puts(" repeat\r\n");
         }
     }
 }
@@ -9,6 +9,9 @@
 
 #include <8052.h>
 
+#define DELAY_NO_TIMER          /* Timer 0 refreshes the LCD (lcdq.h) */
+#include "../../lib/delay.h"
+
 /* ADC0804 Control Pins */
 __sbit __at (0xB5) ADC_CS;
 __sbit __at (0xB6) ADC_RD;
@@ -23,10 +26,8 @@ __sbit __at (0x97) RELAY;     /* P1.7 */
 __sbit __at (0xB2) BTN_UP;    /* Note: shared with ADC_INTR */
 __sbit __at (0xB3) BTN_DOWN;
 
-/* LCD on P2 */
-__sbit __at (0xA0) LCD_RS;
-__sbit __at (0xA1) LCD_EN;
-#define LCD_PORT P2
+/* LCD on P2 (lib defaults: P2.0 = RS, P2.1 = EN, P2.4-P2.7 = data) */
+#include "../../lib/lcdq.h"
 
 /* Controller settings */
 unsigned char setpoint = 25;  /* Target temperature */
@@ -34,61 +35,6 @@ unsigned char hysteresis = 2; /* +/- deadband */
 unsigned char current_temp = 0;
 unsigned char relay_state = 0;
 
-void delay_us(unsigned int us) { while (us--); }
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
-/* LCD Functions */
-void lcd_nibble(unsigned char nibble)
-{
-    LCD_PORT = (LCD_PORT & 0x0F) | (nibble & 0xF0);
-    LCD_EN = 1; delay_us(1); LCD_EN = 0; delay_us(50);
-}
-
-void lcd_cmd(unsigned char cmd)
-{
-    LCD_RS = 0;
-    lcd_nibble(cmd);
-    lcd_nibble(cmd << 4);
-    if (cmd == 0x01) delay_ms(2);
-}
-
-void lcd_data(unsigned char dat)
-{
-    LCD_RS = 1;
-    lcd_nibble(dat);
-    lcd_nibble(dat << 4);
-}
-
-void lcd_puts(char *str) { while (*str) lcd_data(*str++); }
-
-void lcd_goto(unsigned char row, unsigned char col)
-{
-    lcd_cmd((row == 0 ? 0x80 : 0xC0) + col);
-}
-
-void lcd_init(void)
-{
-    delay_ms(20);
-    LCD_RS = 0; LCD_EN = 0;
-    lcd_nibble(0x30); delay_ms(5);
-    lcd_nibble(0x30); delay_us(150);
-    lcd_nibble(0x30); delay_us(150);
-    lcd_nibble(0x20); delay_us(150);
-    lcd_cmd(0x28); lcd_cmd(0x0C);
-    lcd_cmd(0x06); lcd_cmd(0x01);
-}
-
-void lcd_putnum(unsigned char num)
-{
-    lcd_data('0' + (num / 10));
-    lcd_data('0' + (num % 10));
-}
-
 /* ADC Function */
 unsigned char adc_convert(void)
 {
@@ -131,26 +77,24 @@ unsigned char read_temperature(void)
     return millivolts / 10;
 }
 
-/* Update display */
+/*
+ * Update display
+ * Redraws the whole layout into the framebuffer every pass; only the
+ * cells that changed (usually one or two digits) reach the LCD, sent
+ * by the Timer 0 ISR while the control loop carries on.
+ */
 void update_display(void)
 {
-    lcd_goto(0, 0);
-    lcd_puts("Temp: ");
-    lcd_putnum(current_temp);
-    lcd_puts("C  ");
+    lcdfb_puts_at(0, 0, "Temp: ");
+    lcdfb_puts(numfmt_u8(current_temp, 2, '0'));
+    lcdfb_puts("C  ");
 
-    lcd_goto(1, 0);
-    lcd_puts("Set:  ");
-    lcd_putnum(setpoint);
-    lcd_puts("C ");
+    lcdfb_puts_at(1, 0, "Set:  ");
+    lcdfb_puts(numfmt_u8(setpoint, 2, '0'));
+    lcdfb_puts("C ");
 
     /* Show relay status */
-    lcd_goto(1, 12);
-    if (relay_state) {
-        lcd_puts("HEAT");
-    } else {
-        lcd_puts(" OFF");
-    }
+    lcdfb_puts_at(1, 12, relay_state ? "HEAT" : " OFF");
 }
 
 /* Temperature control with hysteresis */
@@ -183,7 +127,9 @@ void main(void)
 
     lcd_puts("Temp Controller");
     delay_ms(1000);
-    lcd_cmd(0x01);
+    lcd_clear();
+    lcdfb_init();
+    lcdq_init();            /* Background refresh from here on */
 
     while (1) {
         /* Read temperature */
@@ -0,0 +1,367 @@
+/*
+ * button.h - Debounced Button Inputs
+ * 8051 Bootcamp Shared Library
+ *
+ * A timer interrupt samples a whole port (or two) every tick and
+ * debounces all pins at once with vertical counters. Presses, releases,
+ * long presses and auto-repeats are latched as flag bits that the main
+ * loop collects whenever it likes - nothing ever waits for a button.
+ *
+ * Usage:
+ *   1. Optional configuration before including:
+ *      #define BUTTON_PORT     P3      Inputs, low byte (default P3)
+ *      #define BUTTON_MASK     0x1C    Pins that are buttons (default 0xFF)
+ *      #define BUTTON_PORT_HI  P0      Optional second port: 16 inputs,
+ *      #define BUTTON_MASK_HI  0xFF    bits 8-15 (default mask 0xFF)
+ *      #define BUTTON_TIMER    0       Timer 0 (default) or 1
+ *      #define BUTTON_TICK_MS  5       Sample period (default 5)
+ *      #define BUTTON_LONG_MASK   0x04 Buttons with a long press (default 0)
+ *      #define BUTTON_LONG_MS     1000 Hold time for it (default 1000)
+ *      #define BUTTON_REPEAT_MASK 0x18 Buttons that auto-repeat (default 0)
+ *      #define BUTTON_REPEAT_MS   500  Hold time before repeat (default 500)
+ *      #define BUTTON_RATE_MS     150  Time between repeats (default 150)
+ *      #include "../../lib/button.h"
+ *
+ *   2. button_init(); then in the main loop, e.g. P3.2 = 0x04:
+ *      if (button_pressed(0x04)) ...       Went down (once per press)
+ *      if (button_repeat(0x08)) ...        Held: fires every RATE
+ *      if (button_long(0x04)) ...          Held for LONG_MS (once)
+ *      if (button_short(0x04)) ...         Released before LONG_MS
+ *
+ * Buttons pull the pin low (pressed = 0 on the pin, 1 in every mask and
+ * result here). Each call returns the requested bits that have fired
+ * since the last call and clears them, so no event is lost however long
+ * the main loop takes. button_held() gives the debounced state.
+ *
+ * Debounce: every pin has a 2-bit counter, kept as two bytes (bit n of
+ * each is pin n's counter), so all 8 or 16 pins are stepped with a few
+ * logic operations. A pin must read its new level on 4 ticks in a row
+ * (15-20ms at the default tick) before the change is accepted; any
+ * bounce restarts its count. About 60 machine cycles per tick with
+ * 8 inputs, roughly 1.3% of the CPU at 11.0592MHz (estimated).
+ *
+ * Long press and repeat use one shared hold timer, restarted whenever a
+ * button in BUTTON_LONG_MASK | BUTTON_REPEAT_MASK changes, so they apply
+ * to one button (or one chord) held on its own.
+ *
+ * BUTTON_TIMER 0 needs DELAY_NO_TIMER (delay_ms() then uses the software
+ * loop) and rules out lcdq.h, SYSTICK_TIMER 0 and seg7.h/keypad.h on
+ * Timer 0; BUTTON_TIMER 1 rules out uart.h on Timer 1 (UART_BAUD_GEN 2
+ * is fine) and seg7.h/keypad.h on Timer 1. Either include order is
+ * caught.
+ */
+
+#ifndef BUTTON_H
+#define BUTTON_H
+
+#include <8052.h>
+
+#ifndef BUTTON_PORT
+#define BUTTON_PORT     P3
+#endif
+
+#ifndef BUTTON_MASK
+#define BUTTON_MASK     0xFF
+#endif
+
+#if defined(BUTTON_PORT_HI) && !defined(BUTTON_MASK_HI)
+#define BUTTON_MASK_HI  0xFF
+#endif
+
+#ifndef BUTTON_TIMER
+#define BUTTON_TIMER    0
+#endif
+
+#ifndef BUTTON_TICK_MS
+#define BUTTON_TICK_MS  5
+#endif
+
+#ifndef BUTTON_LONG_MASK
+#define BUTTON_LONG_MASK    0
+#endif
+
+#ifndef BUTTON_LONG_MS
+#define BUTTON_LONG_MS      1000
+#endif
+
+#ifndef BUTTON_REPEAT_MASK
+#define BUTTON_REPEAT_MASK  0
+#endif
+
+#ifndef BUTTON_REPEAT_MS
+#define BUTTON_REPEAT_MS    500
+#endif
+
+#ifndef BUTTON_RATE_MS
+#define BUTTON_RATE_MS      150
+#endif
+
+#if BUTTON_TIMER == 0
+#if defined(DELAY_H) && !defined(DELAY_NO_TIMER)
+#error "button.h with BUTTON_TIMER 0: define DELAY_NO_TIMER before including delay.h"
+#endif
+#if defined(LCDQ_H) || (defined(SEG7_ISR) && SEG7_TIMER == 0) \
+        || (defined(KEYPAD_H) && KEYPAD_TIMER == 0) \
+        || (defined(SYSTICK_H) && SYSTICK_TIMER == 0)
+#error "button.h needs Timer 0: use BUTTON_TIMER 1"
+#endif
+#ifndef DELAY_NO_TIMER
+#define DELAY_NO_TIMER
+#endif
+#define _BUTTON_TH      TH0
+#define _BUTTON_TL      TL0
+#define _BUTTON_TR      TR0
+#define _BUTTON_ET      ET0
+#define _BUTTON_IRQ     1
+#define _BUTTON_TMOD()  (TMOD = (TMOD & 0xF0) | 0x01)   /* Mode 1, 16-bit */
+#elif BUTTON_TIMER == 1
+#if defined(UART_H) && UART_BAUD_GEN == 1
+#error "button.h with BUTTON_TIMER 1: Timer 1 is the UART baud clock (use UART_BAUD_GEN 2)"
+#endif
+#if (defined(SEG7_ISR) && SEG7_TIMER == 1) || (defined(KEYPAD_H) && KEYPAD_TIMER == 1)
+#error "button.h needs Timer 1: another library already uses it"
+#endif
+#define _BUTTON_TH      TH1
+#define _BUTTON_TL      TL1
+#define _BUTTON_TR      TR1
+#define _BUTTON_ET      ET1
+#define _BUTTON_IRQ     3
+#define _BUTTON_TMOD()  (TMOD = (TMOD & 0x0F) | 0x10)   /* Mode 1, 16-bit */
+#else
+#error "BUTTON_TIMER must be 0 or 1"
+#endif
+
+#include "delay.h"              /* F_CPU */
+
+/* One bit per input: 8 or 16 */
+#ifdef BUTTON_PORT_HI
+typedef unsigned int button_t;
+#define _BUTTON_READ()  ((~(((unsigned int)BUTTON_PORT_HI << 8) | BUTTON_PORT)) \
+                         & (((unsigned int)BUTTON_MASK_HI << 8) | BUTTON_MASK))
+#else
+typedef unsigned char button_t;
+#define _BUTTON_READ()  (~BUTTON_PORT & BUTTON_MASK)
+#endif
+
+/* Tick in machine cycles; hold times in ticks */
+#define _BUTTON_TICK        ((F_CPU / 12000UL) * BUTTON_TICK_MS)
+#define _BUTTON_TICKS(ms)   ((ms) / BUTTON_TICK_MS)
+#define _BUTTON_RELOAD      (65536UL - _BUTTON_TICK)
+#define _BUTTON_HOLD_MASK   (BUTTON_LONG_MASK | BUTTON_REPEAT_MASK)
+
+#if _BUTTON_TICK > 65535
+#error "BUTTON_TICK_MS too long for a 16-bit timer at this F_CPU"
+#endif
+
+#if _BUTTON_HOLD_MASK
+#if _BUTTON_TICKS(BUTTON_LONG_MS) < 1 || _BUTTON_TICKS(BUTTON_LONG_MS) > 65534 \
+        || _BUTTON_TICKS(BUTTON_REPEAT_MS) < 1 || _BUTTON_TICKS(BUTTON_REPEAT_MS) > 65534 \
+        || _BUTTON_TICKS(BUTTON_RATE_MS) < 1 || _BUTTON_TICKS(BUTTON_RATE_MS) > 255
+#error "BUTTON_LONG_MS/BUTTON_REPEAT_MS/BUTTON_RATE_MS out of range for this tick"
+#endif
+#endif
+
+volatile button_t button_state;         /* Bit n = 1: input n held (debounced) */
+
+static button_t _button_ct0, _button_ct1;   /* Vertical 2-bit counters */
+static volatile button_t _button_press;     /* Latched events, cleared when read */
+static volatile button_t _button_release;
+
+#if _BUTTON_HOLD_MASK
+static volatile button_t _button_long;
+static volatile button_t _button_short;
+static volatile button_t _button_repeat;
+static button_t _button_long_done;          /* Held past LONG_MS this time */
+static unsigned int _button_hold;           /* Ticks the held set is unchanged */
+static unsigned char _button_rate;          /* Ticks to the next repeat */
+#endif
+
+#define _BUTTON_LOAD()  do { \
+        _BUTTON_TH = (unsigned char)(_BUTTON_RELOAD >> 8); \
+        _BUTTON_TL = (unsigned char)_BUTTON_RELOAD; \
+    } while (0)
+
+/*
+ * Sample ISR
+ * Steps every pin's counter where the pin differs from its debounced
+ * state, flips the pins whose counter rolled over, and latches events.
+ */
+void button_isr(void) __interrupt(_BUTTON_IRQ)
+{
+    button_t i;
+
+    _BUTTON_LOAD();
+
+    /* Counters count down while a pin differs from its state, else rest at 3 */
+    i = _BUTTON_READ() ^ button_state;
+    _button_ct0 = ~(_button_ct0 & i);
+    _button_ct1 = _button_ct0 ^ (_button_ct1 & i);
+    i &= _button_ct0 & _button_ct1;         /* Rolled over: accept */
+    button_state ^= i;
+
+    _button_press |= button_state & i;
+    _button_release |= ~button_state & i;
+
+#if _BUTTON_HOLD_MASK
+    if (i & _BUTTON_HOLD_MASK) {
+        _button_short |= ~button_state & i & BUTTON_LONG_MASK & ~_button_long_done;
+        _button_long_done &= button_state;
+        _button_hold = 0;
+    }
+
+    if (button_state & _BUTTON_HOLD_MASK) {
+        if (_button_hold != 0xFFFF) _button_hold++;
+
+        if (_button_hold == _BUTTON_TICKS(BUTTON_LONG_MS)) {
+            _button_long |= button_state & BUTTON_LONG_MASK;
+            _button_long_done |= button_state & BUTTON_LONG_MASK;
+        }
+
+        if (_button_hold == _BUTTON_TICKS(BUTTON_REPEAT_MS)) {
+            _button_rate = 1;
+        }
+        if (_button_hold >= _BUTTON_TICKS(BUTTON_REPEAT_MS) && --_button_rate == 0) {
+            _button_rate = _BUTTON_TICKS(BUTTON_RATE_MS);
+            _button_repeat |= button_state & BUTTON_REPEAT_MASK;
+        }
+    }
+#endif
+}
+
+/*
+ * Start sampling
+ * Buttons already held are taken as held, not as new presses.
+ * Enables the timer interrupt and EA.
+ */
+void button_init(void)
+{
+    _BUTTON_TR = 0;
+
+    BUTTON_PORT |= BUTTON_MASK;             /* Pins high = inputs */
+#ifdef BUTTON_PORT_HI
+    BUTTON_PORT_HI |= BUTTON_MASK_HI;
+#endif
+    button_state = _BUTTON_READ();
+    _button_ct0 = _button_ct1 = (button_t)~0;     /* Counters at rest */
+    _button_press = _button_release = 0;
+#if _BUTTON_HOLD_MASK
+    _button_long = _button_short = _button_repeat = 0;
+    _button_long_done = 0;
+    _button_hold = 0;
+#endif
+
+    _BUTTON_TMOD();
+    _BUTTON_LOAD();
+    _BUTTON_ET = 1;
+    EA = 1;
+    _BUTTON_TR = 1;
+}
+
+/* Take and clear event bits (ISR held off for the read-modify-write) */
+#define _BUTTON_TAKE(flags, mask) do { \
+        _BUTTON_ET = 0; \
+        r = (flags) & (mask); \
+        (flags) &= ~r; \
+        _BUTTON_ET = 1; \
+    } while (0)
+
+/*
+ * Buttons pressed since the last call
+ *
+ * @param mask: Buttons to check
+ * @return: Those of them that went down (and clears them)
+ */
+button_t button_pressed(button_t mask)
+{
+    button_t r;
+
+    _BUTTON_TAKE(_button_press, mask);
+    return r;
+}
+
+/*
+ * Buttons released since the last call
+ *
+ * @param mask: Buttons to check
+ * @return: Those of them that came up (and clears them)
+ */
+button_t button_released(button_t mask)
+{
+    button_t r;
+
+    _BUTTON_TAKE(_button_release, mask);
+    return r;
+}
+
+/*
+ * Buttons held right now (debounced)
+ *
+ * @param mask: Buttons to check
+ * @return: Those of them that are down
+ */
+button_t button_held(button_t mask)
+{
+#ifdef BUTTON_PORT_HI
+    button_t r;
+
+    _BUTTON_ET = 0;
+    r = button_state & mask;
+    _BUTTON_ET = 1;
+    return r;
+#else
+    return button_state & mask;
+#endif
+}
+
+#if _BUTTON_HOLD_MASK
+
+/*
+ * Long presses since the last call (BUTTON_LONG_MASK buttons)
+ *
+ * @param mask: Buttons to check
+ * @return: Those held for BUTTON_LONG_MS (once per hold)
+ */
+button_t button_long(button_t mask)
+{
+    button_t r;
+
+    _BUTTON_TAKE(_button_long, mask);
+    return r;
+}
+
+/*
+ * Short presses since the last call (BUTTON_LONG_MASK buttons)
+ *
+ * @param mask: Buttons to check
+ * @return: Those released before BUTTON_LONG_MS
+ */
+button_t button_short(button_t mask)
+{
+    button_t r;
+
+    _BUTTON_TAKE(_button_short, mask);
+    return r;
+}
+
+/*
+ * Press or auto-repeat since the last call (BUTTON_REPEAT_MASK buttons)
+ * Fires on the press, then every BUTTON_RATE_MS after BUTTON_REPEAT_MS.
+ *
+ * @param mask: Buttons to check
+ * @return: Those that pressed or repeated (and clears both)
+ */
+button_t button_repeat(button_t mask)
+{
+    button_t r;
+
+    _BUTTON_ET = 0;
+    r = (_button_press | _button_repeat) & mask;
+    _button_press &= ~r;
+    _button_repeat &= ~r;
+    _BUTTON_ET = 1;
+    return r;
+}
+
+#endif /* _BUTTON_HOLD_MASK */
+
+#endif /* BUTTON_H */
@@ -0,0 +1,329 @@
+/*
+ * capture.h - Timer 2 Capture Timing (8052)
+ * 8051 Bootcamp Shared Library
+ *
+ * Falling edges on T2EX (P1.1) are latched by Timer 2 in hardware: the
+ * count is copied to RCAP2 on the edge itself, so a stamp is exact to
+ * the machine cycle however late the ISR or the main loop runs. The
+ * overflow interrupt extends the 16-bit timer to 32 bits (wraps after
+ * 77 minutes at 11.0592MHz).
+ *
+ * Usage:
+ *   1. Optional configuration, then include:
+ *      #define F_CPU            11059200UL  Crystal frequency (Hz)
+ *      #define CAPTURE_WINDOW_MS 20         Bounce window (default 20)
+ *      #define CAPTURE_QUEUE    8           Queue size (power of two)
+ *      #define CAPTURE_SPACE    __idata     Queue placement
+ *      #include "../../lib/capture.h"
+ *
+ *   2. capture_init();                  Starts Timer 2, enables EA
+ *      unsigned long t;
+ *      if (capture_get(&t)) ...         t = cycle stamp of a press
+ *      capture_now()                    Cycle stamp of "now" (software)
+ *      capture_us(t1 - t0)              Interval in microseconds
+ *
+ *   3. Lap/split, from any stamps:
+ *      capture_start(t);                Start of the run
+ *      capture_split(t)                 Cycles since the start
+ *      capture_lap(t)                   Cycles since the last lap (or
+ *                                       the start); t becomes the mark
+ *
+ * Stamps and intervals are in machine cycles (12 clocks) and wrap
+ * modulo 2^32, so t1 - t0 is right across a wrap. capture_us() is good
+ * for intervals up to 71 minutes.
+ *
+ * Debounce: each bounce is latched too, so edges are filtered as in
+ * extint.h - an edge within CAPTURE_WINDOW_MS of the previous edge is
+ * bounce, and after a quiet spell an edge is a press only if T2EX has
+ * been seen high since the last press. The pin is checked at every
+ * overflow (71ms) and in capture_get(); the release counts once two
+ * checks CAPTURE_WINDOW_MS apart both read high with no edge between
+ * (a fall always latches one), so a reading between two bounces of the
+ * release is not enough. The stamp of a press is its first edge. Rejected edges are counted in capture_rejected, presses
+ * lost to a full queue in capture_dropped.
+ *
+ * Timer 2 belongs to this library: it cannot be combined with
+ * SYSTICK_TIMER 2 or UART_BAUD_GEN 2. Other ISRs must not hold off the
+ * Timer 2 interrupt for more than half an overflow period (35ms).
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <8052.h>
+
+#ifndef F_CPU
+#define F_CPU   11059200UL
+#endif
+
+#if defined(SYSTICK_H) && SYSTICK_TIMER == 2
+#error "Timer 2 is the systick timer: use SYSTICK_TIMER 0 with capture.h"
+#endif
+
+#if defined(UART_H) && UART_BAUD_GEN == 2
+#error "Timer 2 is the UART baud generator: use UART_BAUD_GEN 1 with capture.h"
+#endif
+
+#ifndef CAPTURE_WINDOW_MS
+#define CAPTURE_WINDOW_MS 20
+#endif
+
+#ifndef CAPTURE_QUEUE
+#define CAPTURE_QUEUE   8
+#endif
+
+#ifndef CAPTURE_SPACE
+#define CAPTURE_SPACE   __idata
+#endif
+
+#if CAPTURE_QUEUE < 2 || CAPTURE_QUEUE > 128 || (CAPTURE_QUEUE & (CAPTURE_QUEUE - 1))
+#error "CAPTURE_QUEUE must be a power of two, 2-128"
+#endif
+
+#define _CAPTURE_QMASK  (CAPTURE_QUEUE - 1)
+
+/* Machine cycles per millisecond (rounded down) */
+#define CAPTURE_CYC_MS  (F_CPU / 12000UL)
+#define _CAPTURE_WINDOW ((unsigned long)CAPTURE_CYC_MS * CAPTURE_WINDOW_MS)
+
+/*
+ * Cycles to microseconds: us = cycles * N / D, with N/D = 12e6 / F_CPU
+ * reduced so the remainder product fits in 32 bits.
+ */
+#if defined(CAPTURE_US_NUM) && defined(CAPTURE_US_DEN)
+/* Given by the user */
+#elif F_CPU == 11059200UL
+#define CAPTURE_US_NUM  625UL
+#define CAPTURE_US_DEN  576UL
+#elif F_CPU == 22118400UL
+#define CAPTURE_US_NUM  625UL
+#define CAPTURE_US_DEN  1152UL
+#elif F_CPU % 1000UL == 0
+#define CAPTURE_US_NUM  12000UL
+#define CAPTURE_US_DEN  (F_CPU / 1000UL)
+#else
+#error "Define CAPTURE_US_NUM/CAPTURE_US_DEN (12000000 / F_CPU) for this crystal"
+#endif
+
+__sbit __at (0x91) _CAPTURE_T2EX;   /* P1.1 */
+
+unsigned int capture_rejected;      /* Bounce edges filtered out */
+unsigned char capture_dropped;      /* Presses lost to a full queue */
+
+static CAPTURE_SPACE unsigned long _capture_q[CAPTURE_QUEUE];
+static volatile unsigned char _capture_head;    /* Written by the ISR only */
+static volatile unsigned char _capture_tail;    /* Written by capture_get() only */
+
+static volatile unsigned int _capture_hi;   /* Upper 16 bits of the count */
+static unsigned long _capture_edge;         /* Last edge seen */
+static unsigned long _capture_press;        /* Last edge accepted */
+static volatile __bit _capture_up;          /* T2EX seen released */
+static unsigned long _capture_high;         /* First seen high, no edge since */
+static volatile __bit _capture_quiet;       /* High since _capture_high */
+
+/* Lap/split marks */
+unsigned long capture_t0;
+unsigned long capture_tlap;
+
+/*
+ * Read the 32-bit count into t
+ * With the Timer 2 interrupt held off, or from an ISR of its priority.
+ */
+#define _CAPTURE_READ(t) do { \
+        unsigned char hi_, lo_; \
+        unsigned int h_; \
+        \
+        do { hi_ = TH2; lo_ = TL2; } while (hi_ != TH2); \
+        h_ = _capture_hi; \
+        if (TF2 && !(hi_ & 0x80)) h_++;     /* Overflow pending, count past it */ \
+        (t) = ((unsigned long)h_ << 16) | ((unsigned int)hi_ << 8) | lo_; \
+    } while (0)
+
+/*
+ * Release check at time now, Timer 2 interrupt held off
+ * Released once T2EX reads high at two checks CAPTURE_WINDOW_MS apart
+ * with no edge between; a low reading, an edge, or one latched but not
+ * yet handled (EXF2) starts over.
+ */
+#define _CAPTURE_CHECK_UP(now) do { \
+        if (!_CAPTURE_T2EX || EXF2) { \
+            _capture_quiet = 0; \
+        } else if (!_capture_quiet) { \
+            _capture_quiet = 1; \
+            _capture_high = (now); \
+        } else if ((now) - _capture_high >= _CAPTURE_WINDOW) { \
+            _capture_up = 1; \
+        } \
+    } while (0)
+
+/*
+ * Timer 2 ISR - capture (EXF2) and overflow (TF2)
+ * Both flags share the vector and neither is cleared by hardware. A
+ * capture with an overflow also pending belongs before the overflow if
+ * it was latched in the upper half of the count.
+ */
+void capture_isr(void) __interrupt(5)
+{
+    unsigned long t;
+    unsigned int h;
+    unsigned char hi, lo;
+
+    if (EXF2) {
+        EXF2 = 0;
+        do {                        /* A bounce may capture again */
+            hi = RCAP2H;
+            lo = RCAP2L;
+        } while (hi != RCAP2H);
+        h = _capture_hi;
+        if (TF2 && !(hi & 0x80)) h++;
+        t = ((unsigned long)h << 16) | ((unsigned int)hi << 8) | lo;
+
+        if (t - _capture_edge < _CAPTURE_WINDOW) {
+            /* Bounce; high well after the press means released */
+            if (_CAPTURE_T2EX && t - _capture_press >= _CAPTURE_WINDOW)
+                _capture_up = 1;
+            capture_rejected++;
+        } else if (!_capture_up) {
+            /* Quiet before, but never released: the release bouncing */
+            if (_CAPTURE_T2EX) _capture_up = 1;
+            capture_rejected++;
+        } else {
+            unsigned char hd = _capture_head;
+            unsigned char nx = (hd + 1) & _CAPTURE_QMASK;
+            if (nx != _capture_tail) {
+                _capture_q[hd] = t;
+                _capture_head = nx;
+            } else {
+                capture_dropped++;
+            }
+            _capture_press = t;
+            _capture_up = 0;
+        }
+        _capture_edge = t;
+        _capture_quiet = 0;
+    }
+
+    if (TF2) {
+        TF2 = 0;
+        _capture_hi++;
+        t = (unsigned long)_capture_hi << 16;
+        _CAPTURE_CHECK_UP(t);
+    }
+}
+
+/*
+ * Start Timer 2 in capture mode from 0
+ */
+void capture_init(void)
+{
+    ET2 = 0;
+    T2CON = 0x09;           /* EXEN2 = 1, CP/RL2 = 1: capture on T2EX */
+    TH2 = 0;
+    TL2 = 0;
+    _capture_hi = 0;
+    _capture_head = _capture_tail = 0;
+    capture_rejected = 0;
+    capture_dropped = 0;
+    _capture_up = 1;
+    _capture_quiet = 0;
+    _capture_edge = _capture_press = 0UL - _CAPTURE_WINDOW;
+    capture_t0 = capture_tlap = 0;
+
+    _CAPTURE_T2EX = 1;      /* Input */
+    ET2 = 1;
+    EA = 1;
+    TR2 = 1;
+}
+
+/*
+ * Read the 32-bit count now
+ * For events made by software (an LED lit, a command sent) to be timed
+ * against captured edges.
+ *
+ * @return: Cycle stamp
+ */
+unsigned long capture_now(void)
+{
+    unsigned long t;
+
+    ET2 = 0;
+    _CAPTURE_READ(t);
+    ET2 = 1;
+
+    return t;
+}
+
+/*
+ * Take the oldest press from the queue
+ * Also looks for a release of T2EX (see the debounce notes above).
+ *
+ * @param t: Filled in with the cycle stamp of the press
+ * @return: 1 if there was one, 0 if the queue is empty
+ */
+unsigned char capture_get(unsigned long *t)
+{
+    unsigned long now;
+    unsigned char tl;
+
+    ET2 = 0;
+    _CAPTURE_READ(now);
+    _CAPTURE_CHECK_UP(now);
+    ET2 = 1;
+
+    tl = _capture_tail;
+    if (tl == _capture_head) return 0;
+    *t = _capture_q[tl];
+    _capture_tail = (tl + 1) & _CAPTURE_QMASK;
+    return 1;
+}
+
+/* Nonzero if a press is waiting */
+#define capture_pending()   (_capture_head != _capture_tail)
+
+/*
+ * Convert machine cycles to microseconds
+ *
+ * @param cycles: Interval (difference of two stamps)
+ * @return: Microseconds, rounded down
+ */
+unsigned long capture_us(unsigned long cycles)
+{
+    return (cycles / CAPTURE_US_DEN) * CAPTURE_US_NUM
+           + (cycles % CAPTURE_US_DEN) * CAPTURE_US_NUM / CAPTURE_US_DEN;
+}
+
+/*
+ * Start a run: stamp t is both the start and the first lap mark
+ */
+void capture_start(unsigned long t)
+{
+    capture_t0 = t;
+    capture_tlap = t;
+}
+
+/*
+ * Split: time since the start of the run
+ *
+ * @param t: Cycle stamp
+ * @return: Cycles since capture_start()
+ */
+unsigned long capture_split(unsigned long t)
+{
+    return t - capture_t0;
+}
+
+/*
+ * Lap: time since the previous lap, then t becomes the lap mark
+ *
+ * @param t: Cycle stamp
+ * @return: Cycles since the last capture_lap() or capture_start()
+ */
+unsigned long capture_lap(unsigned long t)
+{
+    unsigned long lap = t - capture_tlap;
+
+    capture_tlap = t;
+    return lap;
+}
+
+#endif /* CAPTURE_H */
@@ -4,36 +4,135 @@
  *
  * Usage: #include "../lib/delay.h"
  *
- * Functions provide software delays for 12MHz crystal.
- * For other frequencies, adjust loop counts accordingly.
+ * All loop counts are derived from F_CPU at compile time.
+ * Define F_CPU (crystal frequency in Hz) before including:
+ *   #define F_CPU 12000000UL
+ *
+ * Default: 11.0592MHz (same crystal the UART library assumes)
+ * Supported crystals: 11.0592MHz, 12MHz, 22.1184MHz, 24MHz
+ *
+ * delay_us()  - cycle-exact DJNZ loop, short waits only
+ * delay_ms()  - Timer 0 (polled), accurate for long waits
+ *               #define DELAY_NO_TIMER to keep Timer 0 free
  */
 
 #ifndef DELAY_H
 #define DELAY_H
 
+#include <8052.h>
+
+#ifndef F_CPU
+#define F_CPU   11059200UL
+#endif
+
+#if F_CPU < 1000000UL || F_CPU > 33000000UL
+#error "F_CPU out of range for a 12-clock 8051"
+#endif
+
+#if defined(SYSTICK_H) && SYSTICK_TIMER == 0 && !defined(DELAY_NO_TIMER)
+#error "systick owns Timer 0: define DELAY_NO_TIMER before including delay.h"
+#endif
+
+/* Machine cycles (12 clocks each) */
+#define DELAY_CYCLES_PER_MS     (F_CPU / 12000UL)
+#define DELAY_US_CYCLES(us)     ((unsigned long)(us) * (F_CPU / 1000UL) / 12000UL)
+
+/*
+ * _delay_loops(n) costs exactly 6 + 2n machine cycles:
+ *   MOV DPL,#n (2) + LCALL (2) + n * DJNZ (2) + RET (2)
+ */
+#define DELAY_LOOP_OVERHEAD     6
+#define DELAY_LOOP_MAX          255
+#define DELAY_US_MAX            ((DELAY_LOOP_OVERHEAD + 2UL * DELAY_LOOP_MAX) \
+                                 * 12000UL / (F_CPU / 1000UL))
+
+/* Nonzero if `us` fits one _delay_loops() call (usable in #if) */
+#define DELAY_US_FITS(us)       ((us) * (F_CPU / 1000UL) / 12000UL \
+                                 < DELAY_LOOP_OVERHEAD + 2UL * DELAY_LOOP_MAX + 2)
+
+/* DJNZ count for `us` microseconds, at least 1 */
+#define DELAY_US_LOOPS(us) \
+    (DELAY_US_CYCLES(us) <= DELAY_LOOP_OVERHEAD + 2 ? 1 : \
+     DELAY_US_CYCLES(us) >= DELAY_LOOP_OVERHEAD + 2 * DELAY_LOOP_MAX ? DELAY_LOOP_MAX : \
+     (DELAY_US_CYCLES(us) - DELAY_LOOP_OVERHEAD) / 2)
+
+/* Software millisecond: split into chunks that fit one _delay_loops() */
+#define DELAY_MS_CHUNKS         (DELAY_CYCLES_PER_MS / 500 + 1)
+#define DELAY_MS_LOOPS          ((DELAY_CYCLES_PER_MS / DELAY_MS_CHUNKS \
+                                  - DELAY_LOOP_OVERHEAD) / 2)
+
+/* Timer 0 mode 1 reload for 1ms */
+#define DELAY_T0_RELOAD         (65536UL - DELAY_CYCLES_PER_MS)
+
 /*
- * Microsecond delay (approximate)
- * Each iteration is roughly 1us at 12MHz
+ * Spin for 6 + 2n machine cycles (n = 0 spins 256 times)
+ * Naked: no prologue, so the count above is exact.
+ */
+static void _delay_loops(unsigned char n) __naked
+{
+    (void)n;
+    __asm
+    00001$:
+        djnz    dpl, 00001$
+        ret
+    __endasm;
+}
+
+/*
+ * Microsecond delay (cycle-exact)
+ * Resolution is 2 machine cycles, minimum 8 cycles. A constant longer
+ * than DELAY_US_MAX fails to compile rather than being cut short.
  *
- * @param us: Number of microseconds to delay
+ * @param us: Compile-time constant, up to DELAY_US_MAX (~550us)
  */
-void delay_us(unsigned int us)
+#define delay_us(us) do { \
+        _Static_assert(DELAY_US_FITS(us), "delay_us() longer than DELAY_US_MAX"); \
+        _delay_loops((unsigned char)DELAY_US_LOOPS(us)); \
+    } while (0)
+
+/*
+ * Millisecond delay using calibrated loops only
+ * Never touches a timer - safe to call while Timer 0 is in use.
+ *
+ * @param ms: Number of milliseconds to delay
+ */
+void delay_ms_sw(unsigned int ms)
 {
-    while (us--);
+    unsigned char k;
+
+    while (ms--) {
+        for (k = DELAY_MS_CHUNKS; k; k--)
+            _delay_loops(DELAY_MS_LOOPS);
+    }
 }
 
 /*
  * Millisecond delay
- * Calibrated for 12MHz crystal
+ * Timer 0 mode 1, polled (no interrupt), one overflow per ms.
+ * Leaves Timer 0 stopped; ET0 is not touched.
  *
  * @param ms: Number of milliseconds to delay
  */
+#ifdef DELAY_NO_TIMER
+#define delay_ms(ms)    delay_ms_sw(ms)
+#else
 void delay_ms(unsigned int ms)
 {
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
+    TMOD = (TMOD & 0xF0) | 0x01;  /* Timer 0, Mode 1 */
+
+    while (ms--) {
+        TR0 = 0;
+        TH0 = (DELAY_T0_RELOAD >> 8) & 0xFF;
+        TL0 = DELAY_T0_RELOAD & 0xFF;
+        TF0 = 0;
+        TR0 = 1;
+        while (!TF0);
+    }
+
+    TR0 = 0;
+    TF0 = 0;
 }
+#endif
 
 /*
  * Second delay
@@ -0,0 +1,192 @@
+/*
+ * display.h - Display Front End (LCD or 7-Segment)
+ * 8051 Bootcamp Shared Library
+ *
+ * One text/number API for both display types. Drawing goes into RAM;
+ * disp_flush() makes it visible. The back end is picked at compile time
+ * and called directly, so there is no dispatch cost.
+ *
+ * Usage:
+ *   1. Pick one back end, configure it as usual, then include:
+ *      #define DISPLAY_LCD                 HD44780 via lcdfb.h
+ *      #define DISPLAY_LCDQ                HD44780 via lcdq.h (Timer 0
+ *                                          sends the changes; implies
+ *                                          DISPLAY_LCD)
+ *      #define DISPLAY_SEG7                Multiplexed digits via seg7.h
+ *      #include "../../lib/display.h"
+ *
+ *   2. disp_init();
+ *      Each update: draw with disp_puts_at()/disp_num(), then
+ *      disp_flush(). 7-segment: keep calling seg7_refresh(), or
+ *      define SEG7_ISR to have a timer interrupt multiplex instead.
+ *
+ * Geometry: LCD_ROWS x LCD_COLS for the LCD, one row of SEG7_NUM_DIGITS
+ * for 7-segment. Text past the end of a row continues on the next row;
+ * past the last cell it is dropped.
+ *
+ * LCD: the disp_xxx() calls are lcdfb.h's, so its shadow buffer is the
+ * only copy of the screen and disp_flush() is lcdfb_flush() - only
+ * changed cells are sent, with short gaps bridged. With DISPLAY_LCDQ the
+ * flush happens in the background and disp_flush() does nothing.
+ *
+ * 7-segment: drawing fills a second set of segment patterns, copied to
+ * seg7_buf[] by disp_flush(), so a half-drawn number is never shown. A
+ * '.' is merged into the preceding digit's decimal point, so
+ * disp_puts("12.5") fills three digits. Letters use seg7.h's font.
+ */
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "numfmt.h"
+
+#if defined(DISPLAY_LCDQ) && !defined(DISPLAY_LCD)
+#define DISPLAY_LCD
+#endif
+
+#if defined(DISPLAY_LCD) && defined(DISPLAY_SEG7)
+#error "Define only one of DISPLAY_LCD and DISPLAY_SEG7"
+#endif
+
+/* ---- Back end: HD44780 character LCD, through lcdfb.h ---- */
+#if defined(DISPLAY_LCD)
+
+#if defined(DISP_SPACE) && !defined(LCDFB_SPACE)
+#define LCDFB_SPACE     DISP_SPACE
+#endif
+
+#ifdef DISPLAY_LCDQ
+#include "lcdq.h"
+#define _disp_be_start()    lcdq_init()
+#else
+#include "lcdfb.h"
+#define _disp_be_start()
+#endif
+
+#define DISP_ROWS       LCD_ROWS
+#define DISP_COLS       LCD_COLS
+
+/* Initialize the LCD and blank the screen */
+#define disp_init()     do { lcd_init(); lcdfb_init(); _disp_be_start(); } while (0)
+
+#define disp_goto(row, col)         lcdfb_goto((row), (col))
+#define disp_putc(c)                lcdfb_putc(c)
+#define disp_puts(str)              lcdfb_puts(str)
+#define disp_puts_at(row, col, str) lcdfb_puts_at((row), (col), (str))
+#define disp_clear()                lcdfb_clear()
+#define disp_flush()                ((void)lcdfb_flush())
+
+/* ---- Back end: multiplexed 7-segment ---- */
+#elif defined(DISPLAY_SEG7)
+
+#include "seg7.h"
+
+#define DISP_ROWS       1
+#define DISP_COLS       SEG7_NUM_DIGITS
+
+static unsigned char _disp_seg[SEG7_NUM_DIGITS];    /* Patterns being drawn */
+unsigned char disp_pos;                             /* Next digit written */
+
+/*
+ * Initialize multiplexing and blank the display
+ */
+void disp_init(void)
+{
+    unsigned char i;
+
+    seg7_init();
+    for (i = 0; i < SEG7_NUM_DIGITS; i++)
+        _disp_seg[i] = SEG7_BLANK;
+    disp_pos = 0;
+}
+
+/*
+ * Set write position
+ *
+ * @param row: Row number (always 0)
+ * @param col: Digit (0 to SEG7_NUM_DIGITS-1, leftmost first)
+ */
+#define disp_goto(row, col)     (disp_pos = (col))
+
+/*
+ * Write character at the write position and advance
+ * A '.' lights the previous digit's decimal point if it is not lit yet.
+ *
+ * @param c: Character
+ */
+void disp_putc(char c)
+{
+    if (c == '.' && disp_pos && !(_disp_seg[disp_pos - 1] & SEG7_DP)) {
+        _disp_seg[disp_pos - 1] |= SEG7_DP;
+        return;
+    }
+    if (disp_pos < SEG7_NUM_DIGITS)
+        _disp_seg[disp_pos++] = seg7_font(c);
+}
+
+/*
+ * Write string at the write position
+ *
+ * @param str: Null-terminated string
+ */
+void disp_puts(char *str)
+{
+    while (*str) disp_putc(*str++);
+}
+
+/*
+ * Write string at specified position
+ *
+ * @param row: Row number (always 0)
+ * @param col: Digit
+ * @param str: Null-terminated string
+ */
+void disp_puts_at(unsigned char row, unsigned char col, char *str)
+{
+    disp_goto(row, col);
+    disp_puts(str);
+}
+
+/*
+ * Blank the whole display (write position to the first digit)
+ */
+void disp_clear(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < SEG7_NUM_DIGITS; i++)
+        _disp_seg[i] = SEG7_BLANK;
+    disp_pos = 0;
+}
+
+/*
+ * Show what has been drawn
+ * A few byte copies; the multiplexer picks them up on its next digit.
+ */
+void disp_flush(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < SEG7_NUM_DIGITS; i++)
+        seg7_buf[i] = _disp_seg[i];
+}
+
+#else
+#error "Define DISPLAY_LCD or DISPLAY_SEG7 before including display.h"
+#endif
+
+/* ---- Shared front end ---- */
+
+/*
+ * Write unsigned number at the write position
+ *
+ * @param v: Value
+ * @param width: Minimum field width
+ * @param pad: ' ' to right-align, '0' for leading zeros
+ */
+void disp_num(unsigned int v, unsigned char width, char pad)
+{
+    disp_puts(numfmt_u16(v, width, pad));
+}
+
+#endif /* DISPLAY_H */
@@ -0,0 +1,297 @@
+/*
+ * extint.h - Timestamped External Interrupt Edges
+ * 8051 Bootcamp Shared Library
+ *
+ * INT0/INT1 falling edges are time-stamped in the interrupt itself and
+ * queued, so the main loop can take them whenever it likes: no edge is
+ * lost while it is busy, and the time of each one is known to the
+ * machine cycle, not to the moment the main loop noticed. Contact bounce
+ * is filtered by time windows on the stamps, not by delays.
+ *
+ * Usage:
+ *   1. Optional configuration, then include (systick.h is included,
+ *      so include extint.h first - it hooks the tick ISR):
+ *      #define EXTINT_INT0             Use INT0, P3.2 (default if neither)
+ *      #define EXTINT_INT1             Use INT1, P3.3
+ *      #define EXTINT_WINDOW_MS 20     Bounce window (default 20)
+ *      #define EXTINT_QUEUE    8       Queue size (power of two, <= 128)
+ *      #define EXTINT_SPACE    __idata Queue placement (default __idata)
+ *      #include "../../lib/extint.h"
+ *
+ *   2. systick_init(); extint_init();
+ *      extint_event_t ev;
+ *      if (extint_get(&ev)) ...        ev.src, ev.ms, ev.cnt
+ *      extint_cycles(&a, &b)           Machine cycles from a to b
+ *
+ * Stamps: ev.ms is the systick millisecond and ev.cnt the raw tick timer
+ * count, read together as systick_snapshot() does. Between two events
+ *   cycles = (ms1 - ms0) * SYSTICK_PERIOD + (signed int)(cnt1 - cnt0)
+ * The stamp is taken a few cycles after the edge (interrupt latency,
+ * 3-9 cycles when no other ISR is running), always the same for both
+ * ends of an interval within a cycle or two.
+ *
+ * Debounce, per input:
+ *   - an edge within EXTINT_WINDOW_MS of the previous edge is bounce;
+ *   - the first edge after a quiet spell is a press only if the pin has
+ *     been seen high (released) since the last press - otherwise it is
+ *     the bounce of the release.
+ *   The pin is checked for release by the edge ISR on every bounce and
+ *   every millisecond by the tick ISR (SYSTICK_HOOK), so a clean release
+ *   is seen however rarely the main loop calls extint_get(). The tick
+ *   only counts it once the pin has read high on every tick, with no
+ *   edge, for EXTINT_WINDOW_MS: one high reading may fall between two
+ *   bounces of the release (the rise raises no interrupt).
+ *   Rejected edges are counted in extint_rejected, events lost to a full
+ *   queue in extint_dropped.
+ *
+ * The tick timer's interrupt must not have a higher priority than
+ * INT0/INT1. SYSTICK_HOOK is taken, and systick.h must not be included
+ * before extint.h (sched.h includes it too). INT1 rules out
+ * UART_FLOW_RTSCTS (CTS on P3.3); INT0 shares P3.2 with the ADC0804
+ * INTR default in adc.h.
+ */
+
+#ifndef EXTINT_H
+#define EXTINT_H
+
+#include <8052.h>
+
+#ifdef SYSTICK_H
+#error "Include extint.h before systick.h/sched.h: it hooks the tick ISR"
+#elif defined(SYSTICK_HOOK)
+#error "extint.h uses SYSTICK_HOOK for its release check"
+#endif
+
+void _extint_tick(void);
+#define SYSTICK_HOOK()  _extint_tick()
+#include "systick.h"
+
+#if !defined(EXTINT_INT0) && !defined(EXTINT_INT1)
+#define EXTINT_INT0
+#endif
+
+#if defined(EXTINT_INT1) && defined(UART_FLOW_RTSCTS)
+#error "extint.h INT1: P3.3 is the UART CTS input"
+#endif
+
+#ifndef EXTINT_WINDOW_MS
+#define EXTINT_WINDOW_MS 20
+#endif
+
+#ifndef EXTINT_QUEUE
+#define EXTINT_QUEUE    8
+#endif
+
+#ifndef EXTINT_SPACE
+#define EXTINT_SPACE    __idata
+#endif
+
+#if EXTINT_QUEUE < 2 || EXTINT_QUEUE > 128 || (EXTINT_QUEUE & (EXTINT_QUEUE - 1))
+#error "EXTINT_QUEUE must be a power of two, 2-128"
+#endif
+
+#define EXTINT_SRC_INT0 0
+#define EXTINT_SRC_INT1 1
+
+#define _EXTINT_QMASK   (EXTINT_QUEUE - 1)
+
+__sbit __at (0xB2) _EXTINT_PIN0;    /* P3.2 */
+__sbit __at (0xB3) _EXTINT_PIN1;    /* P3.3 */
+
+typedef struct {
+    unsigned char src;      /* EXTINT_SRC_INT0 or EXTINT_SRC_INT1 */
+    systick_t ms;           /* systick_ms at the edge */
+    unsigned int cnt;       /* Tick timer count at the edge */
+} extint_event_t;
+
+unsigned int extint_rejected;       /* Bounce edges filtered out */
+unsigned char extint_dropped;       /* Events lost to a full queue */
+
+static EXTINT_SPACE extint_event_t _extint_q[EXTINT_QUEUE];
+static volatile unsigned char _extint_head;     /* Written by the ISRs only */
+static volatile unsigned char _extint_tail;     /* Written by extint_get() only */
+
+static systick_t _extint_edge[2];   /* Last edge seen, per input */
+static systick_t _extint_press[2];  /* Last edge accepted */
+static volatile unsigned char _extint_up;   /* Bit n: input n seen released */
+static systick_t _extint_high[2];   /* Tick the pin was first seen high */
+static volatile unsigned char _extint_hi;   /* Bit n: high, no edge since */
+
+/*
+ * Edge handler body, shared by both ISRs
+ * Stamps the edge (re-reading after an overflow that is pending while
+ * we hold off the tick ISR, corrected as in systick_snapshot()), then
+ * filters and queues it.
+ */
+#define _EXTINT_EDGE(n, pin) do { \
+        unsigned char hi_, lo_; \
+        unsigned int cnt_; \
+        systick_t ms_; \
+        \
+        do { hi_ = SYSTICK_TH; lo_ = SYSTICK_TL; } while (hi_ != SYSTICK_TH); \
+        cnt_ = ((unsigned int)hi_ << 8) | lo_; \
+        ms_ = systick_ms; \
+        if (SYSTICK_TF) { \
+            do { hi_ = SYSTICK_TH; lo_ = SYSTICK_TL; } while (hi_ != SYSTICK_TH); \
+            cnt_ = SYSTICK_PENDING_CNT(((unsigned int)hi_ << 8) | lo_); \
+            ms_++; \
+        } \
+        \
+        if ((systick_t)(ms_ - _extint_edge[n]) < EXTINT_WINDOW_MS) { \
+            /* Bounce; high well after the press means released */ \
+            if ((pin) && (systick_t)(ms_ - _extint_press[n]) >= EXTINT_WINDOW_MS) \
+                _extint_up |= 1 << (n); \
+            extint_rejected++; \
+        } else if (!(_extint_up & (1 << (n)))) { \
+            /* Quiet before, but never released: the release bouncing */ \
+            if (pin) _extint_up |= 1 << (n); \
+            extint_rejected++; \
+        } else { \
+            unsigned char h_ = _extint_head; \
+            unsigned char nx_ = (h_ + 1) & _EXTINT_QMASK; \
+            if (nx_ != _extint_tail) { \
+                _extint_q[h_].src = (n); \
+                _extint_q[h_].ms = ms_; \
+                _extint_q[h_].cnt = cnt_; \
+                _extint_head = nx_; \
+            } else { \
+                extint_dropped++; \
+            } \
+            _extint_press[n] = ms_; \
+            _extint_up &= ~(1 << (n)); \
+        } \
+        _extint_edge[n] = ms_; \
+        _extint_hi &= ~(1 << (n)); \
+    } while (0)
+
+#ifdef EXTINT_INT0
+/*
+ * INT0 ISR - falling edge on P3.2
+ */
+void extint0_isr(void) __interrupt(0)
+{
+    _EXTINT_EDGE(0, _EXTINT_PIN0);
+}
+#endif
+
+#ifdef EXTINT_INT1
+/*
+ * INT1 ISR - falling edge on P3.3
+ */
+void extint1_isr(void) __interrupt(2)
+{
+    _EXTINT_EDGE(1, _EXTINT_PIN1);
+}
+#endif
+
+/*
+ * Start capturing edges
+ * Call after systick_init(); enables the interrupts and EA.
+ */
+void extint_init(void)
+{
+    systick_t now = millis();
+
+    _extint_head = _extint_tail = 0;
+    extint_rejected = 0;
+    extint_dropped = 0;
+    _extint_up = 0x03;
+    _extint_hi = 0;
+    _extint_edge[0] = _extint_edge[1] = now - EXTINT_WINDOW_MS;
+    _extint_press[0] = _extint_press[1] = now - EXTINT_WINDOW_MS;
+
+#ifdef EXTINT_INT0
+    _EXTINT_PIN0 = 1;       /* Input */
+    IE0 = 0;
+    IT0 = 1;                /* Falling edge */
+    EX0 = 1;
+#endif
+#ifdef EXTINT_INT1
+    _EXTINT_PIN1 = 1;
+    IE1 = 0;
+    IT1 = 1;
+    EX1 = 1;
+#endif
+    EA = 1;
+}
+
+/*
+ * Mark an input released once its pin has stayed high for the bounce
+ * window: a low reading or an edge (see _EXTINT_EDGE) starts it over
+ */
+static void _extint_check_up(unsigned char n, __bit pin, systick_t now)
+{
+    unsigned char b = 1 << n;
+
+    if (!pin) {
+        _extint_hi &= ~b;
+    } else if (!(_extint_hi & b)) {
+        _extint_hi |= b;
+        _extint_high[n] = now;
+    } else if ((systick_t)(now - _extint_high[n]) >= EXTINT_WINDOW_MS) {
+        _extint_up |= b;
+    }
+}
+
+/*
+ * Release check, run by the tick ISR every millisecond (SYSTICK_HOOK)
+ * Only inputs not yet seen released, and only while their edge
+ * interrupt is on: not before extint_init(), and never while an edge
+ * ISR of higher priority could be changing the same state. Skipped
+ * while an edge is latched but not yet handled (IE0/IE1): it will
+ * restart the high spell.
+ */
+void _extint_tick(void)
+{
+#ifdef EXTINT_INT0
+    if (EX0 && !IE0 && !(_extint_up & 0x01)) {
+        EX0 = 0;
+        _extint_check_up(0, _EXTINT_PIN0, systick_ms);
+        EX0 = 1;
+    }
+#endif
+#ifdef EXTINT_INT1
+    if (EX1 && !IE1 && !(_extint_up & 0x02)) {
+        EX1 = 0;
+        _extint_check_up(1, _EXTINT_PIN1, systick_ms);
+        EX1 = 1;
+    }
+#endif
+}
+
+/*
+ * Take the oldest edge from the queue
+ *
+ * @param ev: Filled in with the event
+ * @return: 1 if there was one, 0 if the queue is empty
+ */
+unsigned char extint_get(extint_event_t *ev)
+{
+    unsigned char t;
+
+    t = _extint_tail;
+    if (t == _extint_head) return 0;
+    ev->src = _extint_q[t].src;
+    ev->ms = _extint_q[t].ms;
+    ev->cnt = _extint_q[t].cnt;
+    _extint_tail = (t + 1) & _EXTINT_QMASK;
+    return 1;
+}
+
+/* Nonzero if an edge is waiting */
+#define extint_pending()    (_extint_head != _extint_tail)
+
+/*
+ * Machine cycles between two events
+ *
+ * @param a: Earlier event
+ * @param b: Later event
+ * @return: Cycles from a to b (12 clocks each; 1.085us at 11.0592MHz)
+ */
+unsigned long extint_cycles(extint_event_t *a, extint_event_t *b)
+{
+    return (unsigned long)(systick_t)(b->ms - a->ms) * SYSTICK_PERIOD
+           + (signed int)(b->cnt - a->cnt);
+}
+
+#endif /* EXTINT_H */
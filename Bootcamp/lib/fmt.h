@@ -0,0 +1,245 @@
+/*
+ * fmt.h - Minimal Formatted Output
+ * 8051 Bootcamp Shared Library
+ *
+ * A small printf replacement built on numfmt.h, writing to a pluggable
+ * character sink.
+ *
+ * Usage:
+ *   1. Runtime sink (default): set it once, switch any time
+ *        #include "../lib/fmt.h"
+ *        fmt_set_sink(uart_tx);
+ *        fmt_printf("T=%3d C\r\n", temp);
+ *
+ *   2. Fixed sink: all output compiles to direct calls, no pointer
+ *        #define FMT_SINK uart_tx
+ *        #include "../lib/fmt.h"
+ *
+ * Conversions: %u %d %x %X %s %c %%
+ *   Flags/width: %5u (space padded), %04x (zero padded), width <= 11
+ *   Size:        int by default, %l... for long, %b... for an argument
+ *                explicitly cast to (char) - SDCC passes those as one byte
+ *
+ * Compile-time formatting (no format string parsed at run time):
+ *   FMT(F_STR("Count: "), F_U(n), F_STR(" (0x"), F_XW(n, 2), F_STR(")\r\n"));
+ * expands to one direct call per item. F_UB()/F_XBW() convert a byte
+ * with the 8-bit numfmt routines, cheaper than the 16-bit F_U()/F_XW().
+ * #define FMT_NO_PRINTF to leave out fmt_printf()/fmt_sprintf() and
+ * their format parser when only FMT() is used.
+ *
+ * Cost: fmt_printf() brings in the format parser once and is slower
+ * per call than FMT(); Module_06 06_fmt_benchmark.c measures the cycles
+ * and code size of both against hand-written calls.
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdarg.h>
+#include "numfmt.h"
+
+typedef void (*fmt_sink_t)(unsigned char c);
+
+#ifdef FMT_SINK
+#define _fmt_out(c)     FMT_SINK(c)
+#else
+fmt_sink_t fmt_sink;
+#define _fmt_out(c)     fmt_sink(c)
+
+/*
+ * Select output sink
+ *
+ * @param sink: Function taking one character (uart_tx, lcd_data, ...)
+ */
+void fmt_set_sink(fmt_sink_t sink)
+{
+    fmt_sink = sink;
+}
+#endif
+
+/* RAM buffer target used by fmt_sprintf(), 0 when inactive */
+char *_fmt_bufp;
+unsigned char _fmt_buf_left;
+
+static void _fmt_emit(char c)
+{
+    if (_fmt_bufp) {
+        if (_fmt_buf_left > 1) {
+            *_fmt_bufp++ = c;
+            _fmt_buf_left--;
+        }
+    } else {
+        _fmt_out(c);
+    }
+}
+
+/*
+ * Write string to the sink
+ *
+ * @param s: Null-terminated string
+ */
+void fmt_puts(char *s)
+{
+    while (*s) _fmt_emit(*s++);
+}
+
+#ifndef FMT_NO_PRINTF
+/*
+ * Format to the sink (see header for conversions)
+ *
+ * @param fmt: Format string
+ * @param ap: Argument list
+ */
+void fmt_vprintf(char *fmt, va_list ap)
+{
+    char c;
+    char pad;
+    unsigned char width;
+    unsigned char size;     /* 0 = int, 1 = char, 2 = long */
+    unsigned char n;
+    unsigned long v;
+    char *s;
+
+    while ((c = *fmt++) != '\0') {
+        if (c != '%') {
+            _fmt_emit(c);
+            continue;
+        }
+
+        pad = ' ';
+        width = 0;
+        size = 0;
+        c = *fmt++;
+
+        if (c == '0') {
+            pad = '0';
+            c = *fmt++;
+        }
+        while (c >= '0' && c <= '9') {
+            width = width * 10 + (c - '0');
+            c = *fmt++;
+        }
+        if (c == 'b') {
+            size = 1;
+            c = *fmt++;
+        } else if (c == 'l') {
+            size = 2;
+            c = *fmt++;
+        }
+
+        switch (c) {
+            case 'u':
+            case 'd':
+            case 'x':
+            case 'X':
+                if (size == 2) {
+                    v = va_arg(ap, unsigned long);
+                } else if (size == 1) {
+                    n = va_arg(ap, char);
+                    v = (c == 'd') ? (signed long)(signed char)n : n;
+                } else if (c == 'd') {
+                    v = (signed long)va_arg(ap, int);
+                } else {
+                    v = (unsigned int)va_arg(ap, int);
+                }
+
+                if (c == 'd') {
+                    s = numfmt_s32((signed long)v, width, pad);
+                } else if (c == 'u') {
+                    s = (v <= 0xFFFF) ? numfmt_u16((unsigned int)v, width, pad)
+                                      : numfmt_u32(v, width, pad);
+                } else {
+                    s = numfmt_hex32(v, width, pad);
+                }
+                fmt_puts(s);
+                break;
+
+            case 's':
+                s = va_arg(ap, char *);
+                for (n = 0; s[n]; n++);
+                while (width > n) {
+                    _fmt_emit(' ');
+                    width--;
+                }
+                fmt_puts(s);
+                break;
+
+            case 'c':
+                if (size == 1) _fmt_emit(va_arg(ap, char));
+                else _fmt_emit((char)va_arg(ap, int));
+                break;
+
+            case '\0':
+                return;     /* Stray '%' at end of string */
+
+            default:        /* "%%" and unknown conversions */
+                _fmt_emit(c);
+                break;
+        }
+    }
+}
+
+/*
+ * Formatted output to the sink
+ *
+ * @param fmt: Format string
+ */
+void fmt_printf(char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    fmt_vprintf(fmt, ap);
+    va_end(ap);
+}
+
+/*
+ * Formatted output to a RAM buffer
+ * Null-terminated; output beyond size-1 characters is dropped. With
+ * size 0 nothing is written.
+ *
+ * @param buf: Destination
+ * @param size: Buffer size including terminator
+ * @param fmt: Format string
+ * @return: Number of characters stored
+ */
+unsigned char fmt_sprintf(char *buf, unsigned char size, char *fmt, ...)
+{
+    va_list ap;
+
+    if (size == 0) return 0;    /* No room even for the terminator */
+
+    _fmt_bufp = buf;
+    _fmt_buf_left = size;
+
+    va_start(ap, fmt);
+    fmt_vprintf(fmt, ap);
+    va_end(ap);
+
+    *_fmt_bufp = '\0';
+    _fmt_bufp = 0;
+    return size - _fmt_buf_left;
+}
+#endif /* FMT_NO_PRINTF */
+
+/*
+ * Compile-time formatting
+ * Each item becomes one direct call; no format string at run time.
+ */
+#define FMT(...)            do { __VA_ARGS__; } while (0)
+
+#define F_STR(s)            fmt_puts(s)
+#define F_CHR(c)            _fmt_emit(c)
+#define F_UB(v)             fmt_puts(numfmt_u8((v), 0, ' '))
+#define F_XBW(v, w)         fmt_puts(numfmt_hex8((v), (w), '0'))
+#define F_U(v)              fmt_puts(numfmt_u16((v), 0, ' '))
+#define F_UW(v, w, pad)     fmt_puts(numfmt_u16((v), (w), (pad)))
+#define F_D(v)              fmt_puts(numfmt_s16((v), 0, ' '))
+#define F_DW(v, w, pad)     fmt_puts(numfmt_s16((v), (w), (pad)))
+#define F_UL(v)             fmt_puts(numfmt_u32((v), 0, ' '))
+#define F_DL(v)             fmt_puts(numfmt_s32((v), 0, ' '))
+#define F_X(v)              fmt_puts(numfmt_hex16((v), 0, ' '))
+#define F_XW(v, w)          fmt_puts(numfmt_hex16((v), (w), '0'))
+#define F_XL(v)             fmt_puts(numfmt_hex32((v), 0, ' '))
+
+#endif /* FMT_H */
@@ -0,0 +1,452 @@
+/*
+ * keypad.h - Background 4x4 Matrix Keypad Scanner
+ * 8051 Bootcamp Shared Library
+ *
+ * A timer interrupt scans one row per tick and debounces every key with
+ * its own counter. Key changes become events in a queue; the application
+ * pops them whenever it likes and never waits on the keypad.
+ *
+ * Usage:
+ *   1. Optional configuration before including:
+ *      #define KEYPAD_PORT     P2      Rows bits 0-3 (out), columns bits
+ *                                      4-7 (in, pulled up) (default P2)
+ *      #define KEYPAD_TIMER    0       Timer 0 (default) or 1
+ *      #define KEYPAD_TICK_US  2000    Time per row (default 2000)
+ *      #define KEYPAD_DEBOUNCE 3       Scans to accept a change (default 3)
+ *      #define KEYPAD_REPEAT_MS 500    Hold time before repeat, 0 = off
+ *      #define KEYPAD_RATE_MS  100     Time between repeats (default 100)
+ *      #define KEYPAD_QUEUE    8       Queue size (power of two, <= 128)
+ *      #define KEYPAD_KEYMAP   keys    __code char keys[16] of legends,
+ *                                      row 0 first (default 123A456B...)
+ *      #define KEYPAD_EVENT_HOOK() fn()  Called from the ISR after an
+ *                                      event is queued (e.g. sched_signal)
+ *      #include "../../lib/keypad.h"
+ *
+ *   2. keypad_init(); then
+ *      e = keypad_get();                   0 = no event
+ *      if (KEYPAD_TYPE(e) == KEYPAD_PRESS) c = keypad_char(e);
+ *      or simply c = keypad_getkey();      Waits for a press or repeat
+ *
+ * Events are one byte: KEYPAD_PRESS, KEYPAD_RELEASE or KEYPAD_REPEAT in
+ * bits 6-7, key number (row * 4 + column) in bits 0-3. A press made
+ * while other keys are held also has KEYPAD_CHORD set; keypad_held()
+ * then gives the whole chord. A held key repeats after KEYPAD_REPEAT_MS,
+ * the most recently pressed one only.
+ *
+ * Each tick reads the columns of the row driven on the previous tick
+ * (so the lines have a whole tick to settle, no delay needed), then
+ * drives the next row. A key's counter climbs by one per scan while it
+ * reads pressed and falls while it reads released; the key is pressed
+ * when it reaches KEYPAD_DEBOUNCE and released when it is back at 0, so
+ * a bounce only delays the change. All 16 keys are tracked at once (any
+ * number can be held) and keypad_raw has the undebounced bitmap of the
+ * last full scan.
+ *
+ * Ghosting: without diodes, three held keys on the corners of a
+ * rectangle make the fourth corner read as pressed too. Whenever two
+ * rows read two or more columns in common the pattern is ambiguous:
+ * keypad_ghost is set, a KEYPAD_GHOST event is queued, and no new press
+ * is accepted until it clears (releases still are). Keys already down
+ * stay down.
+ *
+ * Cost: a row whose keys all read as debounced skips the counters, so
+ * an idle or steadily held keypad takes about 70 machine cycles per tick
+ * (~4% of the CPU at the defaults and 11.0592MHz), about 160 while a key
+ * is settling (estimated). Defaults: 8ms per scan, ~24ms to accept a
+ * change.
+ *
+ * The queue has one writer (the ISR) and one reader (keypad_get()), each
+ * owning one index, so neither side masks interrupts. When it is full
+ * new events are dropped and counted in keypad_dropped.
+ *
+ * KEYPAD_TIMER 0 needs DELAY_NO_TIMER (delay_ms() then uses the software
+ * loop) and rules out lcdq.h, SYSTICK_TIMER 0 and seg7.h/button.h on
+ * Timer 0; KEYPAD_TIMER 1 rules out uart.h on Timer 1 (UART_BAUD_GEN 2
+ * is fine) and seg7.h/button.h on Timer 1. Either include order is
+ * caught.
+ */
+
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+#include <8052.h>
+
+#ifndef KEYPAD_PORT
+#define KEYPAD_PORT     P2
+#endif
+
+#ifndef KEYPAD_TIMER
+#define KEYPAD_TIMER    0
+#endif
+
+#ifndef KEYPAD_TICK_US
+#define KEYPAD_TICK_US  2000
+#endif
+
+#ifndef KEYPAD_DEBOUNCE
+#define KEYPAD_DEBOUNCE 3
+#endif
+
+#ifndef KEYPAD_REPEAT_MS
+#define KEYPAD_REPEAT_MS 500
+#endif
+
+#ifndef KEYPAD_RATE_MS
+#define KEYPAD_RATE_MS  100
+#endif
+
+#ifndef KEYPAD_QUEUE
+#define KEYPAD_QUEUE    8
+#endif
+
+#if KEYPAD_DEBOUNCE < 1 || KEYPAD_DEBOUNCE > 255
+#error "KEYPAD_DEBOUNCE must be 1-255"
+#endif
+
+#if KEYPAD_QUEUE < 2 || KEYPAD_QUEUE > 128 || (KEYPAD_QUEUE & (KEYPAD_QUEUE - 1))
+#error "KEYPAD_QUEUE must be a power of two, 2-128"
+#endif
+
+#if KEYPAD_TIMER == 0
+#if defined(DELAY_H) && !defined(DELAY_NO_TIMER)
+#error "keypad.h with KEYPAD_TIMER 0: define DELAY_NO_TIMER before including delay.h"
+#endif
+#if defined(LCDQ_H) || (defined(SEG7_ISR) && SEG7_TIMER == 0) \
+        || (defined(SYSTICK_H) && SYSTICK_TIMER == 0) \
+        || (defined(BUTTON_H) && BUTTON_TIMER == 0)
+#error "keypad.h needs Timer 0: use KEYPAD_TIMER 1"
+#endif
+#ifndef DELAY_NO_TIMER
+#define DELAY_NO_TIMER
+#endif
+#define _KEYPAD_TH      TH0
+#define _KEYPAD_TL      TL0
+#define _KEYPAD_TR      TR0
+#define _KEYPAD_ET      ET0
+#define _KEYPAD_IRQ     1
+#define _KEYPAD_TMOD()  (TMOD = (TMOD & 0xF0) | 0x01)   /* Mode 1, 16-bit */
+#elif KEYPAD_TIMER == 1
+#if defined(UART_H) && UART_BAUD_GEN == 1
+#error "keypad.h with KEYPAD_TIMER 1: Timer 1 is the UART baud clock (use UART_BAUD_GEN 2)"
+#endif
+#if defined(SEG7_ISR) && SEG7_TIMER == 1
+#error "keypad.h and seg7.h both use Timer 1"
+#endif
+#if defined(BUTTON_H) && BUTTON_TIMER == 1
+#error "keypad.h and button.h both use Timer 1"
+#endif
+#define _KEYPAD_TH      TH1
+#define _KEYPAD_TL      TL1
+#define _KEYPAD_TR      TR1
+#define _KEYPAD_ET      ET1
+#define _KEYPAD_IRQ     3
+#define _KEYPAD_TMOD()  (TMOD = (TMOD & 0x0F) | 0x10)   /* Mode 1, 16-bit */
+#else
+#error "KEYPAD_TIMER must be 0 or 1"
+#endif
+
+#include "delay.h"              /* F_CPU */
+
+/* Tick in machine cycles; repeat times in whole scans (4 ticks) */
+#define _KEYPAD_TICK        ((F_CPU / 12000UL) * KEYPAD_TICK_US / 1000UL)
+#define _KEYPAD_SCANS(ms)   ((ms) * 1000UL / (KEYPAD_TICK_US * 4UL))
+#define _KEYPAD_RELOAD      (65536UL - _KEYPAD_TICK)
+
+#if _KEYPAD_TICK < 300 || _KEYPAD_TICK > 65535
+#error "KEYPAD_TICK_US out of range for a 16-bit timer at this F_CPU"
+#endif
+
+#if KEYPAD_REPEAT_MS
+#if _KEYPAD_SCANS(KEYPAD_REPEAT_MS) < 1 || _KEYPAD_SCANS(KEYPAD_REPEAT_MS) > 255 \
+        || _KEYPAD_SCANS(KEYPAD_RATE_MS) < 1 || _KEYPAD_SCANS(KEYPAD_RATE_MS) > 255
+#error "KEYPAD_REPEAT_MS/KEYPAD_RATE_MS out of range for this tick"
+#endif
+#endif
+
+#ifndef KEYPAD_EVENT_HOOK
+#define KEYPAD_EVENT_HOOK()
+#endif
+
+/* Event types (bits 6-7), flags (bits 4-5) and key number (bits 0-3) */
+#define KEYPAD_PRESS    0x40
+#define KEYPAD_RELEASE  0x80
+#define KEYPAD_REPEAT   0xC0
+#define KEYPAD_CHORD    0x20    /* Press while other keys are held */
+#define KEYPAD_GHOST    0x10    /* Ambiguous pattern appeared (type 0) */
+#define KEYPAD_TYPE(e)  ((e) & 0xC0)
+#define KEYPAD_KEY(e)   ((e) & 0x0F)
+
+#define _KEYPAD_NONE    0xFF
+#define _KEYPAD_QMASK   (KEYPAD_QUEUE - 1)
+
+#ifndef KEYPAD_KEYMAP
+#define KEYPAD_KEYMAP   KEYPAD_KEYS
+__code char KEYPAD_KEYS[16] = {
+    '1', '2', '3', 'A',
+    '4', '5', '6', 'B',
+    '7', '8', '9', 'C',
+    '*', '0', '#', 'D'
+};
+#endif
+
+/* Row drive patterns (row low, columns left high as inputs) */
+__code unsigned char _KEYPAD_DRIVE[4] = {0xFE, 0xFD, 0xFB, 0xF7};
+
+/* keypad_state bit of each row's first key */
+__code unsigned int _KEYPAD_ROWBIT[4] = {0x0001, 0x0010, 0x0100, 0x1000};
+
+/* Keys lit in a column nibble */
+__code unsigned char _KEYPAD_NKEYS[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+/* Bit of each row pair in _keypad_ghost_pairs */
+__code unsigned char _KEYPAD_PAIR[4][4] = {
+    {0x00, 0x01, 0x02, 0x04},
+    {0x01, 0x00, 0x08, 0x10},
+    {0x02, 0x08, 0x00, 0x20},
+    {0x04, 0x10, 0x20, 0x00}
+};
+
+volatile unsigned int keypad_state;     /* Bit n = 1: key n held (debounced) */
+volatile unsigned int keypad_raw;       /* Bit n = 1: key n read pressed */
+volatile __bit keypad_ghost;            /* Ambiguous pattern on the matrix */
+unsigned char keypad_dropped;           /* Events lost to a full queue */
+
+static __idata unsigned char _keypad_cnt[16];   /* Debounce counters */
+static unsigned char _keypad_raw[4];            /* Last read, per row */
+static unsigned char _keypad_deb[4];            /* Debounced, per row */
+static unsigned char _keypad_busy[4];           /* Counters mid-way, per row */
+static unsigned char _keypad_ghost_pairs;       /* Row pairs sharing 2+ columns */
+static unsigned char _keypad_row;               /* Row being driven */
+
+static unsigned char _keypad_q[KEYPAD_QUEUE];
+static volatile unsigned char _keypad_head;     /* Written by the ISR only */
+static volatile unsigned char _keypad_tail;     /* Written by keypad_get() only */
+
+#if KEYPAD_REPEAT_MS
+static unsigned char _keypad_rep_key;           /* Key that repeats, or none */
+static unsigned char _keypad_rep_cnt;           /* Scans to its next repeat */
+#endif
+
+/* Queue an event (ISR only): store first, then publish the index */
+#define _KEYPAD_PUSH(e) do { \
+        unsigned char n_ = (_keypad_head + 1) & _KEYPAD_QMASK; \
+        if (n_ != _keypad_tail) { \
+            _keypad_q[_keypad_head] = (e); \
+            _keypad_head = n_; \
+            KEYPAD_EVENT_HOOK(); \
+        } else { \
+            keypad_dropped++; \
+        } \
+    } while (0)
+
+#define _KEYPAD_LOAD()  do { \
+        _KEYPAD_TH = (unsigned char)(_KEYPAD_RELOAD >> 8); \
+        _KEYPAD_TL = (unsigned char)_KEYPAD_RELOAD; \
+    } while (0)
+
+/*
+ * Scan ISR - one row per tick
+ * Reads the row driven last tick, checks it against the other rows for
+ * ghosting, steps its counters unless they are all at rest, queues
+ * events, then drives the next row. Repeats are timed once per scan.
+ */
+void keypad_isr(void) __interrupt(_KEYPAD_IRQ)
+{
+    unsigned char row = _keypad_row;
+    unsigned char cols;
+    unsigned char deb;
+    unsigned char busy;
+    unsigned char cbit;
+    unsigned char k;
+    unsigned char n;
+    unsigned int mask;
+
+    _KEYPAD_LOAD();
+
+    cols = (~KEYPAD_PORT >> 4) & 0x0F;      /* 1 = pressed */
+    _keypad_raw[row] = cols;
+
+    /* Two rows with 2+ columns in common: a rectangle, maybe a ghost */
+    for (k = 0; k < 4; k++) {
+        n = _KEYPAD_PAIR[row][k];
+        if (_KEYPAD_NKEYS[cols & _keypad_raw[k]] >= 2) {
+            _keypad_ghost_pairs |= n;
+        } else {
+            _keypad_ghost_pairs &= ~n;
+        }
+    }
+    if (!_keypad_ghost_pairs) {
+        keypad_ghost = 0;
+    } else if (!keypad_ghost) {
+        keypad_ghost = 1;
+        _KEYPAD_PUSH(KEYPAD_GHOST);
+    }
+
+    deb = _keypad_deb[row];
+    if (cols != deb || _keypad_busy[row]) {
+        busy = 0;
+        k = row << 2;
+        mask = _KEYPAD_ROWBIT[row];
+
+        for (cbit = 1; cbit != 0x10; cbit <<= 1, k++, mask <<= 1) {
+            n = _keypad_cnt[k];
+            if (cols & cbit) {
+                /* Climb; a new press waits while the matrix is ambiguous */
+                if (n != KEYPAD_DEBOUNCE && (!keypad_ghost || (deb & cbit))) {
+                    _keypad_cnt[k] = ++n;
+                    if (n == KEYPAD_DEBOUNCE && !(deb & cbit)) {
+                        deb |= cbit;
+                        _KEYPAD_PUSH(KEYPAD_PRESS | k |
+                                     (keypad_state ? KEYPAD_CHORD : 0));
+                        keypad_state |= mask;
+#if KEYPAD_REPEAT_MS
+                        _keypad_rep_key = k;
+                        _keypad_rep_cnt = _KEYPAD_SCANS(KEYPAD_REPEAT_MS);
+#endif
+                    }
+                }
+            } else if (n) {
+                _keypad_cnt[k] = --n;
+                if (n == 0 && (deb & cbit)) {
+                    deb &= ~cbit;
+                    keypad_state &= ~mask;
+                    _KEYPAD_PUSH(KEYPAD_RELEASE | k);
+#if KEYPAD_REPEAT_MS
+                    if (_keypad_rep_key == k) _keypad_rep_key = _KEYPAD_NONE;
+#endif
+                }
+            }
+            if (n && n != KEYPAD_DEBOUNCE) busy |= cbit;
+        }
+
+        _keypad_deb[row] = deb;
+        _keypad_busy[row] = busy;
+    }
+
+    row = (row + 1) & 3;
+    _keypad_row = row;
+    KEYPAD_PORT = _KEYPAD_DRIVE[row];
+
+    if (row == 0) {
+        keypad_raw = ((unsigned int)(_keypad_raw[2] | (_keypad_raw[3] << 4)) << 8)
+                   | (_keypad_raw[0] | (_keypad_raw[1] << 4));
+#if KEYPAD_REPEAT_MS
+        if (_keypad_rep_key != _KEYPAD_NONE && --_keypad_rep_cnt == 0) {
+            _keypad_rep_cnt = _KEYPAD_SCANS(KEYPAD_RATE_MS);
+            _KEYPAD_PUSH(KEYPAD_REPEAT | _keypad_rep_key);
+        }
+#endif
+    }
+}
+
+/*
+ * Start background scanning
+ * Enables the timer interrupt and EA.
+ */
+void keypad_init(void)
+{
+    unsigned char i;
+
+    _KEYPAD_TR = 0;
+    for (i = 0; i < 16; i++)
+        _keypad_cnt[i] = 0;
+    for (i = 0; i < 4; i++)
+        _keypad_raw[i] = _keypad_deb[i] = _keypad_busy[i] = 0;
+    _keypad_ghost_pairs = 0;
+    keypad_ghost = 0;
+    keypad_state = 0;
+    keypad_raw = 0;
+    keypad_dropped = 0;
+    _keypad_head = _keypad_tail = 0;
+#if KEYPAD_REPEAT_MS
+    _keypad_rep_key = _KEYPAD_NONE;
+#endif
+
+    _keypad_row = 0;
+    KEYPAD_PORT = _KEYPAD_DRIVE[0];
+    _KEYPAD_TMOD();
+    _KEYPAD_LOAD();
+    _KEYPAD_ET = 1;
+    EA = 1;
+    _KEYPAD_TR = 1;
+}
+
+/* Nonzero if an event is waiting */
+#define keypad_pending()    (_keypad_head != _keypad_tail)
+
+/*
+ * Take the oldest event from the queue
+ *
+ * @return: Event (KEYPAD_TYPE | key number), 0 if none
+ */
+unsigned char keypad_get(void)
+{
+    unsigned char e;
+
+    if (_keypad_tail == _keypad_head) return 0;
+    e = _keypad_q[_keypad_tail];
+    _keypad_tail = (_keypad_tail + 1) & _KEYPAD_QMASK;
+    return e;
+}
+
+/*
+ * Legend of an event's key
+ *
+ * @param e: Event from keypad_get()
+ * @return: Character from KEYPAD_KEYMAP
+ */
+char keypad_char(unsigned char e)
+{
+    return KEYPAD_KEYMAP[KEYPAD_KEY(e)];
+}
+
+/*
+ * Wait for the next press or repeat
+ * Releases are skipped; does not wait for the key to come up.
+ *
+ * @return: Character from KEYPAD_KEYMAP
+ */
+char keypad_getkey(void)
+{
+    unsigned char e;
+
+    do {
+        e = keypad_get();
+    } while (KEYPAD_TYPE(e) != KEYPAD_PRESS && KEYPAD_TYPE(e) != KEYPAD_REPEAT);
+
+    return keypad_char(e);
+}
+
+/*
+ * Keys held right now (debounced)
+ *
+ * @return: Bit n set for key n (row * 4 + column)
+ */
+unsigned int keypad_held(void)
+{
+    unsigned int s;
+
+    _KEYPAD_ET = 0;
+    s = keypad_state;
+    _KEYPAD_ET = 1;
+    return s;
+}
+
+/*
+ * Number of keys held right now (debounced)
+ *
+ * @return: 0-16
+ */
+unsigned char keypad_count(void)
+{
+    unsigned char i;
+    unsigned char n = 0;
+
+    for (i = 0; i < 4; i++)
+        n += _KEYPAD_NKEYS[_keypad_deb[i]];
+    return n;
+}
+
+#endif /* KEYPAD_H */
@@ -1,5 +1,5 @@
 /*
- * lcd.h - 16x2 LCD Library (4-bit mode)
+ * lcd.h - Character LCD Library (HD44780, 4-bit or 8-bit mode)
  * 8051 Bootcamp Shared Library
  *
  * Usage:
@@ -12,12 +12,54 @@
  *   2. Or use defaults (P2.0=RS, P2.1=EN, P2.4-7=Data)
  *
  * LCD is connected in 4-bit mode using upper nibble of data port
+ *
+ * Interface options (compile time, no run-time cost):
+ *   #define LCD_8BIT                 D0-D7 on a whole port (default P1),
+ *                                    one EN strobe per byte
+ *   #define LCD_DATA_DEDICATED       4-bit mode, whole LCD_DATA port
+ *                                    written without masking (its bits
+ *                                    0-3 unused, so LCD_RS/LCD_EN and
+ *                                    LCD_RW must be defined on another
+ *                                    port - the P2 defaults are refused)
+ *   Module_08 05_lcd_benchmark.c measures each combination.
+ *
+ * Geometry (compile time, default 16x2):
+ *   #define LCD_COLS 20              16, 20 or 40
+ *   #define LCD_ROWS 4               2 or 4
+ *   #define LCD_EN2 P2_3             Second enable line of a dual-
+ *                                    controller panel (40x4): rows 0-1
+ *                                    on EN, rows 2-3 on EN2
+ *   Rows are addressed through a DDRAM offset table, so lcd_goto() is
+ *   the same call on every panel. With LCD_EN2, commands other than
+ *   cursor moves go to both controllers (CGRAM uploads included);
+ *   lcd_goto() selects the one that gets the following characters.
+ *
+ * Busy-flag mode (RW wired to a port pin instead of GND):
+ *   #define LCD_USE_BUSY
+ *   #define LCD_RW P2_2              Default P2.2
+ *   Each write waits only until the controller's busy flag clears
+ *   instead of a fixed worst-case delay (50us per nibble, 2ms after
+ *   CLEAR/HOME). lcd_init() first checks that status reads work by
+ *   setting a DDRAM address and reading it back; if they do not (RW
+ *   not connected) or the flag later never clears, the library uses
+ *   the fixed delays for good.
  */
 
 #ifndef LCD_H
 #define LCD_H
 
 #include <8052.h>
+#include "delay.h"
+#include "numfmt.h"
+
+#if defined(LCD_DATA_DEDICATED) && !defined(LCD_8BIT)
+#if !defined(LCD_RS) || !defined(LCD_EN)
+#error "LCD_DATA_DEDICATED: define LCD_RS and LCD_EN on a port other than LCD_DATA"
+#endif
+#if defined(LCD_USE_BUSY) && !defined(LCD_RW)
+#error "LCD_DATA_DEDICATED: define LCD_RW on a port other than LCD_DATA"
+#endif
+#endif
 
 /* Default pin definitions (can override before include) */
 #ifndef LCD_RS
@@ -28,9 +70,44 @@ __sbit __at (0xA0) LCD_RS;    /* P2.0 */
 __sbit __at (0xA1) LCD_EN;    /* P2.1 */
 #endif
 
+#ifndef LCD_COLS
+#define LCD_COLS        16
+#endif
+
+#ifndef LCD_ROWS
+#define LCD_ROWS        2
+#endif
+
+#if LCD_COLS > 40 || (LCD_ROWS != 2 && LCD_ROWS != 4)
+#error "lcd.h supports up to 40 columns and 2 or 4 rows"
+#endif
+
+#if LCD_ROWS == 4 && LCD_COLS > 20 && !defined(LCD_EN2)
+#error "4-row panels wider than 20 columns have two controllers: define LCD_EN2"
+#endif
+
 #ifndef LCD_DATA
+#ifdef LCD_8BIT
+#define LCD_DATA P1           /* P1.0-P1.7 for data */
+#else
 #define LCD_DATA P2           /* P2.4-P2.7 for data */
 #endif
+#endif
+
+#ifdef LCD_USE_BUSY
+#ifndef LCD_RW
+__sbit __at (0xA2) LCD_RW;    /* P2.2 */
+#endif
+
+#ifndef LCD_BUSY_TIMEOUT
+#define LCD_BUSY_TIMEOUT 200  /* Status reads (~5ms) before giving up */
+#endif
+
+__bit lcd_busy_ok;            /* 1 = busy flag works, 0 = fixed delays */
+#define _LCD_POLLING    lcd_busy_ok
+#else
+#define _LCD_POLLING    0
+#endif
 
 /* LCD Commands */
 #define LCD_CLEAR       0x01
@@ -40,47 +117,227 @@ __sbit __at (0xA1) LCD_EN;    /* P2.1 */
 #define LCD_CURSOR_ON   0x0E
 #define LCD_BLINK_ON    0x0F
 #define LCD_FUNC_4BIT   0x28
+#define LCD_FUNC_8BIT   0x38
+#define LCD_CGRAM       0x40
 #define LCD_LINE1       0x80
 #define LCD_LINE2       0xC0
 
-/* Internal delay functions */
-static void _lcd_delay_us(unsigned int us)
-{
-    while (us--);
-}
+/*
+ * Set-DDRAM-address command for the start of each row
+ * Single controller: rows 2/3 continue rows 0/1 after LCD_COLS cells.
+ * Dual controller: rows 2/3 are rows 0/1 of the second one.
+ */
+__code unsigned char _lcd_row_addr[4] = {
+#ifdef LCD_EN2
+    LCD_LINE1, LCD_LINE2, LCD_LINE1, LCD_LINE2
+#else
+    LCD_LINE1, LCD_LINE2, LCD_LINE1 + LCD_COLS, LCD_LINE2 + LCD_COLS
+#endif
+};
 
-static void _lcd_delay_ms(unsigned int ms)
+#define _LCD_ROW_ADDR(row)  (_lcd_row_addr[row])
+
+/*
+ * Controller selection (dual-controller panels)
+ *   _lcd_en1/_lcd_en2: which enable lines the next transfer strobes
+ *   _LCD_SELECT(row):  pick the controller that owns a row
+ */
+#ifdef LCD_EN2
+__bit _lcd_en1, _lcd_en2;
+#define _LCD_SELECT(row)    do { _lcd_en1 = ((row) < 2); _lcd_en2 = !_lcd_en1; } while (0)
+#define _LCD_BOTH()         do { _lcd_en1 = 1; _lcd_en2 = 1; } while (0)
+#else
+#define _LCD_SELECT(row)
+#define _LCD_BOTH()
+#endif
+
+/* Internal delays (F_CPU calibrated, never touch Timer 0) */
+#define _lcd_delay_us(us)   delay_us(us)
+#define _lcd_delay_ms(ms)   delay_ms_sw(ms)
+
+/*
+ * Port access, specialised at compile time
+ *   _LCD_OUT(v):  put v on the data lines (upper nibble in 4-bit mode)
+ *   _LCD_PULSE(): EN high >= 450ns, then low - the LCD latches on the
+ *                 falling edge
+ */
+#if defined(LCD_8BIT) || defined(LCD_DATA_DEDICATED)
+#define _LCD_OUT(v)         (LCD_DATA = (v))
+#define _LCD_RELEASE()      (LCD_DATA = 0xFF)
+#else
+#define _LCD_OUT(v)         (LCD_DATA = (LCD_DATA & 0x0F) | ((v) & 0xF0))
+#define _LCD_RELEASE()      (LCD_DATA |= 0xF0)
+#endif
+
+#ifdef LCD_EN2
+#define _LCD_PULSE()        do { \
+        if (_lcd_en1) { LCD_EN = 1; __asm__("nop"); LCD_EN = 0; } \
+        if (_lcd_en2) { LCD_EN2 = 1; __asm__("nop"); LCD_EN2 = 0; } \
+    } while (0)
+#else
+#define _LCD_PULSE()        do { LCD_EN = 1; __asm__("nop"); LCD_EN = 0; } while (0)
+#endif
+
+/*
+ * Write a whole byte (RS already set), no waiting
+ * Inline so it can be used from an ISR (see lcdq.h).
+ */
+#ifdef LCD_8BIT
+#define _LCD_PUT_BYTE(b)    do { _LCD_OUT(b); _LCD_PULSE(); } while (0)
+#else
+#define _LCD_PUT_BYTE(b)    do { \
+        _LCD_OUT(b); _LCD_PULSE(); \
+        _LCD_OUT((b) << 4); _LCD_PULSE(); \
+    } while (0)
+#endif
+
+/*
+ * Latch one transfer into the LCD
+ * 4-bit mode: upper 4 bits of the argument, 8-bit mode: all of it
+ */
+static void _lcd_strobe(unsigned char v)
 {
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
+    _LCD_OUT(v);
+    _LCD_PULSE();
 }
 
 /*
- * Send 4-bit nibble to LCD
+ * Send one transfer to LCD with fixed delay (init, fallback mode)
  */
 static void lcd_nibble(unsigned char nibble)
 {
-    LCD_DATA = (LCD_DATA & 0x0F) | (nibble & 0xF0);
-    LCD_EN = 1;
-    _lcd_delay_us(1);
-    LCD_EN = 0;
+    _lcd_strobe(nibble);
     _lcd_delay_us(50);
 }
 
+#ifdef LCD_USE_BUSY
+
+/* Enable line for reads: one controller at a time (EN unless only EN2) */
+#ifdef LCD_EN2
+#define _LCD_EN_READ(v)     do { if (_lcd_en1) LCD_EN = (v); else LCD_EN2 = (v); } while (0)
+#else
+#define _LCD_EN_READ(v)     (LCD_EN = (v))
+#endif
+
+static unsigned char _lcd_read_nibble(void)
+{
+    unsigned char v;
+
+    _LCD_EN_READ(1);
+    __asm__("nop");         /* Data valid 360ns after EN rises */
+#ifdef LCD_8BIT
+    v = LCD_DATA;
+#else
+    v = LCD_DATA & 0xF0;
+#endif
+    _LCD_EN_READ(0);
+    return v;
+}
+
+/*
+ * Read busy flag and address counter
+ * Dual-controller panels: of the controller selected by lcd_goto()
+ *
+ * @return: Bit 7 = busy flag, bits 6-0 = DDRAM/CGRAM address
+ */
+unsigned char lcd_read_status(void)
+{
+    unsigned char v;
+
+    _LCD_RELEASE();         /* Data pins high so the LCD can drive them */
+    LCD_RS = 0;
+    LCD_RW = 1;
+    v = _lcd_read_nibble();
+#ifndef LCD_8BIT
+    v |= _lcd_read_nibble() >> 4;
+#endif
+    LCD_RW = 0;
+    return v;
+}
+
+/*
+ * Wait for the busy flag to clear
+ * On timeout switch to fixed delays (covering a CLEAR in progress).
+ * Only called once lcd_init() has seen status reads work.
+ */
+static void _lcd_wait_one(void)
+{
+    unsigned char n = LCD_BUSY_TIMEOUT;
+
+    while (lcd_read_status() & 0x80) {
+        if (--n == 0) {
+            lcd_busy_ok = 0;
+            _lcd_delay_ms(2);
+            return;
+        }
+    }
+}
+
+#ifdef LCD_EN2
+/* Both controllers selected: wait for each in turn */
+static void _lcd_wait(void)
+{
+    if (_lcd_en1 && _lcd_en2) {
+        _lcd_en2 = 0;
+        _lcd_wait_one();
+        _lcd_en1 = 0;
+        _lcd_en2 = 1;
+        _lcd_wait_one();
+        _lcd_en1 = 1;
+    } else {
+        _lcd_wait_one();
+    }
+}
+#else
+#define _lcd_wait()     _lcd_wait_one()
+#endif
+
+#endif /* LCD_USE_BUSY */
+
+/*
+ * Write one byte (two nibbles in 4-bit mode)
+ * Busy-flag mode waits *before* the write, so the CPU only stalls if
+ * the previous instruction has not finished yet.
+ *
+ * @param rs: 0 = instruction, 1 = data
+ * @param b: Byte to write
+ */
+static void _lcd_write(unsigned char rs, unsigned char b)
+{
+#ifdef LCD_USE_BUSY
+    if (lcd_busy_ok) {
+        _lcd_wait();
+        LCD_RS = rs;
+        _LCD_PUT_BYTE(b);
+        return;
+    }
+#endif
+    LCD_RS = rs;
+    lcd_nibble(b);
+#ifndef LCD_8BIT
+    lcd_nibble(b << 4);
+#endif
+}
+
 /*
  * Send command to LCD
+ * Dual-controller panels: cursor moves (0x80+) go to the controller
+ * selected by lcd_goto(), everything else to both.
  *
  * @param cmd: Command byte
  */
 void lcd_cmd(unsigned char cmd)
 {
-    LCD_RS = 0;
-    lcd_nibble(cmd);
-    lcd_nibble(cmd << 4);
+#ifdef LCD_EN2
+    if (cmd < LCD_LINE1) _LCD_BOTH();
+#endif
+
+    _lcd_write(0, cmd);
 
-    if (cmd == LCD_CLEAR || cmd == LCD_HOME)
-        _lcd_delay_ms(2);
+    if (cmd == LCD_CLEAR || cmd == LCD_HOME) {
+        if (!_LCD_POLLING) _lcd_delay_ms(2);
+        _LCD_SELECT(0);     /* Text continues at the top left */
+    }
 }
 
 /*
@@ -90,13 +347,29 @@ void lcd_cmd(unsigned char cmd)
  */
 void lcd_data(unsigned char dat)
 {
-    LCD_RS = 1;
-    lcd_nibble(dat);
-    lcd_nibble(dat << 4);
+    _lcd_write(1, dat);
 }
 
+#ifdef LCD_USE_BUSY
+#define _LCD_PROBE_ADDR (LCD_LINE2 + 3)    /* Address 0x43: bits in both nibbles */
+
 /*
- * Initialize LCD in 4-bit mode
+ * Check that status reads work (called with lcd_busy_ok still 0)
+ * Sets a DDRAM address and reads it back. With RW tied to GND the read
+ * is a write instead: the data pins are high, so the LCD takes 0xFF (a
+ * cursor move, undone by the CLEAR that follows) and 0xFF is read back.
+ *
+ * @return: 1 if the address came back
+ */
+static unsigned char _lcd_probe(void)
+{
+    lcd_cmd(_LCD_PROBE_ADDR);
+    return lcd_read_status() == (_LCD_PROBE_ADDR & 0x7F);
+}
+#endif
+
+/*
+ * Initialize LCD (4-bit, or 8-bit with LCD_8BIT)
  * Must be called before any other LCD functions
  */
 void lcd_init(void)
@@ -105,6 +378,14 @@ void lcd_init(void)
 
     LCD_RS = 0;
     LCD_EN = 0;
+#ifdef LCD_EN2
+    LCD_EN2 = 0;
+    _LCD_BOTH();            /* Same init sequence for both controllers */
+#endif
+#ifdef LCD_USE_BUSY
+    LCD_RW = 0;
+    lcd_busy_ok = 0;        /* Fixed delays until the probe below */
+#endif
 
     /* Special initialization sequence */
     lcd_nibble(0x30);
@@ -113,13 +394,24 @@ void lcd_init(void)
     _lcd_delay_us(150);
     lcd_nibble(0x30);
     _lcd_delay_us(150);
+#ifndef LCD_8BIT
     lcd_nibble(0x20);
     _lcd_delay_us(150);
+#endif
 
     /* Configure LCD */
+#ifdef LCD_8BIT
+    lcd_cmd(LCD_FUNC_8BIT);   /* 8-bit, 2 line, 5x7 */
+#else
     lcd_cmd(LCD_FUNC_4BIT);   /* 4-bit, 2 line, 5x7 */
+#endif
     lcd_cmd(LCD_DISPLAY_ON);  /* Display ON, cursor OFF */
     lcd_cmd(LCD_ENTRY_INC);   /* Increment cursor */
+
+#ifdef LCD_USE_BUSY
+    lcd_busy_ok = _lcd_probe();   /* Poll only if RW really reads */
+#endif
+
     lcd_cmd(LCD_CLEAR);       /* Clear display */
 }
 
@@ -142,14 +434,13 @@ void lcd_home(void)
 /*
  * Set cursor position
  *
- * @param row: Row number (0 or 1)
- * @param col: Column number (0-15)
+ * @param row: Row number (0 to LCD_ROWS-1)
+ * @param col: Column number (0 to LCD_COLS-1)
  */
 void lcd_goto(unsigned char row, unsigned char col)
 {
-    unsigned char addr;
-    addr = (row == 0) ? LCD_LINE1 : LCD_LINE2;
-    lcd_cmd(addr + col);
+    _LCD_SELECT(row);
+    lcd_cmd(_LCD_ROW_ADDR(row) + col);
 }
 
 /*
@@ -167,8 +458,8 @@ void lcd_puts(char *str)
 /*
  * Display string at specified position
  *
- * @param row: Row number (0 or 1)
- * @param col: Column number (0-15)
+ * @param row: Row number (0 to LCD_ROWS-1)
+ * @param col: Column number (0 to LCD_COLS-1)
  * @param str: Null-terminated string
  */
 void lcd_puts_at(unsigned char row, unsigned char col, char *str)
@@ -184,9 +475,7 @@ void lcd_puts_at(unsigned char row, unsigned char col, char *str)
  */
 void lcd_putnum(unsigned char num)
 {
-    if (num >= 100) lcd_data('0' + num / 100);
-    if (num >= 10) lcd_data('0' + (num / 10) % 10);
-    lcd_data('0' + num % 10);
+    lcd_puts(numfmt_u8(num, 0, ' '));
 }
 
 /*
@@ -196,16 +485,7 @@ void lcd_putnum(unsigned char num)
  */
 void lcd_putint(unsigned int num)
 {
-    char buf[6];
-    signed char i = 4;
-
-    buf[5] = '\0';
-    do {
-        buf[i--] = '0' + (num % 10);
-        num /= 10;
-    } while (num > 0 && i >= 0);
-
-    lcd_puts(&buf[i + 1]);
+    lcd_puts(numfmt_u16(num, 0, ' '));
 }
 
 /*
@@ -215,13 +495,7 @@ void lcd_putint(unsigned int num)
  */
 void lcd_puthex(unsigned char num)
 {
-    unsigned char nibble;
-
-    nibble = (num >> 4) & 0x0F;
-    lcd_data(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
-
-    nibble = num & 0x0F;
-    lcd_data(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
+    lcd_puts(numfmt_hex8(num, 2, '0'));
 }
 
 #endif /* LCD_H */
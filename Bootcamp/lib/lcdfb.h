@@ -0,0 +1,232 @@
+/*
+ * lcdfb.h - LCD Shadow Framebuffer
+ * 8051 Bootcamp Shared Library
+ *
+ * Keeps a RAM copy of the screen plus a dirty bit per cell. Drawing
+ * functions only touch RAM; lcdfb_flush() sends the cells that really
+ * changed, moving the LCD cursor only where the next changed cell is
+ * not already under it. A screen that is redrawn every pass but barely
+ * changes costs a few LCD writes instead of 34.
+ *
+ * Usage:
+ *   1. Configure lcd.h as usual, then include:
+ *      #define LCDFB_SPACE __idata      Buffer placement (default __idata)
+ *      #include "../../lib/lcdfb.h"     (includes lcd.h)
+ *
+ *   2. lcd_init(); lcdfb_init();
+ *      Each update: draw with lcdfb_puts_at() etc., then lcdfb_flush().
+ *
+ * Mixing in direct lcd_xxx() calls desynchronises the shadow copy; call
+ * lcdfb_invalidate() afterwards to redraw everything on the next flush.
+ * Include lcdq.h instead to have a timer ISR do the flushing.
+ *
+ * RAM: one byte per cell + one dirty byte per 8 cells + 4 state bytes:
+ *   16x2: 40 bytes    20x4: 94 bytes    40x4: 184 bytes
+ * A 40x4 buffer in __idata leaves about 70 bytes of the 8052's 256 for
+ * everything else including the stack; with external or on-chip XRAM
+ * define LCDFB_SPACE __xdata instead (MOVX access, slightly slower).
+ */
+
+#ifndef LCDFB_H
+#define LCDFB_H
+
+#include "lcd.h"           /* LCD_COLS x LCD_ROWS geometry */
+
+#ifndef LCDFB_SPACE
+#define LCDFB_SPACE     __idata
+#endif
+
+/* Called whenever a cell becomes dirty (lcdq.h starts its timer here) */
+#ifndef LCDFB_KICK
+#define LCDFB_KICK()
+#endif
+
+#define LCDFB_SIZE      (LCD_ROWS * LCD_COLS)
+#define _LCDFB_DBYTES   ((LCDFB_SIZE + 7) / 8)
+
+#if LCDFB_SIZE > 255
+#error "lcdfb.h supports at most 255 cells"
+#endif
+
+#define _LCDFB_NOWHERE  0xFF    /* LCD cursor position unknown */
+
+LCDFB_SPACE char lcdfb_buf[LCDFB_SIZE];         /* Wanted screen contents */
+LCDFB_SPACE unsigned char lcdfb_dirty[_LCDFB_DBYTES];  /* 1 = differs from LCD */
+__bit lcdfb_changed;                            /* Any dirty bit set */
+
+unsigned char lcdfb_pos;        /* Next cell lcdfb_putc() writes */
+static unsigned char _lcdfb_row, _lcdfb_col;    /* LCD cursor (row, col) */
+
+__code unsigned char _LCDFB_BIT[8] = {0x01, 0x02, 0x04, 0x08,
+                                      0x10, 0x20, 0x40, 0x80};
+
+/*
+ * Store character in a cell, marking it dirty if it changed
+ *
+ * @param i: Cell index (row * LCD_COLS + col)
+ * @param c: Character
+ */
+static void _lcdfb_set(unsigned char i, char c)
+{
+    if (lcdfb_buf[i] != c) {
+        lcdfb_buf[i] = c;
+        lcdfb_dirty[i >> 3] |= _LCDFB_BIT[i & 7];
+        lcdfb_changed = 1;
+        LCDFB_KICK();
+    }
+}
+
+/*
+ * Mark every cell dirty and forget the LCD cursor
+ * Use after writing to the LCD directly or re-initializing it.
+ */
+void lcdfb_invalidate(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < _LCDFB_DBYTES; i++)
+        lcdfb_dirty[i] = 0xFF;
+    lcdfb_changed = 1;
+    _lcdfb_row = _LCDFB_NOWHERE;
+    LCDFB_KICK();
+}
+
+/*
+ * Initialize framebuffer to match a freshly cleared LCD
+ * Call after lcd_init() (or lcd_clear()).
+ */
+void lcdfb_init(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < LCDFB_SIZE; i++)
+        lcdfb_buf[i] = ' ';
+    for (i = 0; i < _LCDFB_DBYTES; i++)
+        lcdfb_dirty[i] = 0;
+    lcdfb_changed = 0;
+    lcdfb_pos = 0;
+    _lcdfb_row = _LCDFB_NOWHERE;
+}
+
+/*
+ * Set write position
+ *
+ * @param row: Row number (0 to LCD_ROWS-1)
+ * @param col: Column number (0 to LCD_COLS-1)
+ */
+void lcdfb_goto(unsigned char row, unsigned char col)
+{
+    lcdfb_pos = row * LCD_COLS + col;
+}
+
+/*
+ * Write character at the write position and advance
+ * Writing past the last cell is ignored.
+ *
+ * @param c: Character
+ */
+void lcdfb_putc(char c)
+{
+    if (lcdfb_pos < LCDFB_SIZE)
+        _lcdfb_set(lcdfb_pos++, c);
+}
+
+/*
+ * Write string at the write position (continues onto the next row)
+ *
+ * @param str: Null-terminated string
+ */
+void lcdfb_puts(char *str)
+{
+    while (*str) lcdfb_putc(*str++);
+}
+
+/*
+ * Write string at specified position
+ *
+ * @param row: Row number
+ * @param col: Column number
+ * @param str: Null-terminated string
+ */
+void lcdfb_puts_at(unsigned char row, unsigned char col, char *str)
+{
+    lcdfb_goto(row, col);
+    lcdfb_puts(str);
+}
+
+/*
+ * Blank from the write position to the end of its row
+ * Replaces printing a row of spaces before shorter text.
+ */
+void lcdfb_clear_eol(void)
+{
+    unsigned char end = lcdfb_pos - lcdfb_pos % LCD_COLS + LCD_COLS;
+
+    while (lcdfb_pos < end && lcdfb_pos < LCDFB_SIZE)
+        _lcdfb_set(lcdfb_pos++, ' ');
+}
+
+/*
+ * Blank the whole screen (write position to 0,0)
+ * Only cells that were not already blank get sent.
+ */
+void lcdfb_clear(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < LCDFB_SIZE; i++)
+        _lcdfb_set(i, ' ');
+    lcdfb_pos = 0;
+}
+
+#ifdef LCDFB_NO_FLUSH
+
+/* Cells are sent in the background (lcdq.h) */
+#define lcdfb_flush()   0
+
+#else
+
+/*
+ * Send changed cells to the LCD
+ * A cursor move is only issued when the next changed cell is not under
+ * the cursor; a single unchanged cell in between is rewritten instead,
+ * which costs the same one write but keeps the cursor moving.
+ *
+ * @return: Number of LCD writes (commands + characters) sent
+ */
+unsigned char lcdfb_flush(void)
+{
+    unsigned char row, col, i, d;
+    unsigned char writes = 0;
+
+    if (!lcdfb_changed) return 0;
+    lcdfb_changed = 0;
+
+    i = 0;
+    for (row = 0; row < LCD_ROWS; row++) {
+        for (col = 0; col < LCD_COLS; col++, i++) {
+            d = _LCDFB_BIT[i & 7];
+            if (!(lcdfb_dirty[i >> 3] & d)) continue;
+            lcdfb_dirty[i >> 3] &= ~d;
+
+            if (row == _lcdfb_row && col == _lcdfb_col + 1) {
+                lcd_data(lcdfb_buf[i - 1]);     /* Bridge one clean cell */
+                writes++;
+            } else if (row != _lcdfb_row || col != _lcdfb_col) {
+                lcd_goto(row, col);
+                writes++;
+            }
+
+            lcd_data(lcdfb_buf[i]);
+            writes++;
+            _lcdfb_row = row;
+            _lcdfb_col = col + 1;
+        }
+    }
+
+    return writes;
+}
+
+#endif /* LCDFB_NO_FLUSH */
+
+#endif /* LCDFB_H */
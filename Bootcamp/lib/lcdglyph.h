@@ -0,0 +1,265 @@
+/*
+ * lcdglyph.h - LCD Custom Glyph Manager
+ * 8051 Bootcamp Shared Library
+ *
+ * The HD44780 has 8 user-definable characters (CGRAM). Glyphs here are
+ * 8-byte bitmaps in __code; lcdg_get() returns the character code for a
+ * glyph, uploading it only if it is not already in one of the 8 slots
+ * (least recently used slot is replaced). Redrawing with the same glyphs
+ * costs no CGRAM writes at all.
+ *
+ * Usage:
+ *   1. Include after lcd.h, lcdfb.h or lcdq.h:
+ *      #include "../../lib/lcdglyph.h"
+ *      With lcdfb.h/lcdq.h the drawing functions write to the
+ *      framebuffer, otherwise straight to the LCD.
+ *
+ *   2. lcd_init(); lcdg_init();
+ *      lcd_bargraph(1, adc_value);          Row 1, 0-255 full scale
+ *      lcd_bignum(0, 0, temp, 3);           3 big digits on rows 0-1
+ *
+ *   3. Own glyphs:
+ *      __code unsigned char BELL[8] = {0x04, 0x0E, 0x0E, 0x0E,
+ *                                      0x1F, 0x00, 0x04, 0x00};
+ *      c = lcdg_get(BELL);                  Before lcd_goto()
+ *      lcd_goto(0, 15); lcd_data(c);
+ *
+ * Codes returned are 8-15 (the HD44780 mirrors CGRAM 0-7 there), so a
+ * glyph never reads as a string terminator. Uploading moves the LCD's
+ * address into CGRAM: with plain lcd.h, call lcdg_get() before
+ * lcd_goto(); lcdfb/lcdq re-position by themselves.
+ *
+ * A glyph evicted while still on screen changes shape there, so keep the
+ * glyphs visible at once to 8 or fewer. The bar graph uses up to 4 (one
+ * partial cell at a time, full cells are ROM character 0xFF) and big
+ * digits 3, so both fit together with one slot to spare.
+ *
+ * RAM: 16 bytes of slot tags + 8 bytes LRU order + 2 bytes counter.
+ */
+
+#ifndef LCDGLYPH_H
+#define LCDGLYPH_H
+
+#include "lcd.h"
+
+#define LCDG_SLOTS      8
+#define LCDG_FULL       0xFF    /* ROM full block */
+#define LCDG_CODE(slot) (8 + (slot))
+
+/* Drawing goes through the framebuffer when there is one */
+#ifdef LCDFB_H
+#define _LCDG_GOTO(r, c)    lcdfb_goto(r, c)
+#define _LCDG_PUT(ch)       lcdfb_putc(ch)
+#else
+#define _LCDG_GOTO(r, c)    lcd_goto(r, c)
+#define _LCDG_PUT(ch)       lcd_data(ch)
+#endif
+
+/* Bar graph: 1-4 of the 5 pixel columns lit, from the left */
+__code unsigned char LCDG_BAR[4][8] = {
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+    {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E}
+};
+
+/* Big digits: top bar, bottom bar, top + bottom bars */
+__code unsigned char LCDG_BIG[3][8] = {
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x1F, 0x1F, 0x1F}
+};
+
+/*
+ * Big digit layout, 3x2 cells: top row then bottom row
+ * 0 = blank, 1 = full block, 2 = top bar, 3 = bottom bar, 4 = both bars
+ */
+__code unsigned char _LCDG_DIGITS[10][6] = {
+    {1, 2, 1,  1, 3, 1},    /* 0 */
+    {2, 1, 0,  3, 1, 3},    /* 1 */
+    {4, 4, 1,  1, 3, 3},    /* 2 */
+    {2, 4, 1,  3, 3, 1},    /* 3 */
+    {1, 3, 1,  0, 0, 1},    /* 4 */
+    {1, 4, 4,  3, 3, 1},    /* 5 */
+    {1, 4, 4,  1, 3, 1},    /* 6 */
+    {2, 2, 1,  0, 0, 1},    /* 7 */
+    {1, 4, 1,  1, 3, 1},    /* 8 */
+    {1, 4, 1,  3, 3, 1}     /* 9 */
+};
+
+static __code unsigned char *_lcdg_tag[LCDG_SLOTS];   /* Glyph per slot, 0 = none */
+static unsigned char _lcdg_lru[LCDG_SLOTS];           /* Slots, most recent first */
+
+unsigned int lcdg_uploads;      /* CGRAM uploads since lcdg_init() */
+
+/*
+ * Forget all slots
+ * Call after lcd_init() (CGRAM contents are undefined at power-up).
+ */
+void lcdg_init(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < LCDG_SLOTS; i++) {
+        _lcdg_tag[i] = 0;
+        _lcdg_lru[i] = i;
+    }
+    lcdg_uploads = 0;
+}
+
+/*
+ * Write a glyph bitmap into a CGRAM slot
+ * With lcdq.h the refresh ISR is held off and told to re-position.
+ */
+static void _lcdg_upload(unsigned char slot, __code unsigned char *glyph)
+{
+    unsigned char i;
+
+#ifdef LCDQ_H
+    ET0 = 0;
+    _lcd_delay_us(50);          /* Let the ISR's last write finish */
+#endif
+    lcd_cmd(LCD_CGRAM | (slot << 3));
+    for (i = 0; i < 8; i++)
+        lcd_data(glyph[i]);
+#ifdef LCDFB_H
+    _lcdfb_row = _LCDFB_NOWHERE;
+#endif
+#ifdef LCDQ_H
+    ET0 = 1;
+#endif
+    lcdg_uploads++;
+}
+
+/*
+ * Get the character code for a glyph, uploading it if needed
+ *
+ * @param glyph: 8-byte bitmap in __code (rows top to bottom, bits 4-0)
+ * @return: Character code (8-15)
+ */
+unsigned char lcdg_get(__code unsigned char *glyph)
+{
+    unsigned char i;
+    unsigned char slot;
+
+    for (i = 0; i < LCDG_SLOTS - 1; i++)
+        if (_lcdg_tag[_lcdg_lru[i]] == glyph) break;
+
+    slot = _lcdg_lru[i];
+    if (_lcdg_tag[slot] != glyph) {     /* Miss: replace least recent */
+        _lcdg_tag[slot] = glyph;
+        _lcdg_upload(slot, glyph);
+    }
+
+    for (; i; i--)                      /* Move to front */
+        _lcdg_lru[i] = _lcdg_lru[i - 1];
+    _lcdg_lru[0] = slot;
+
+    return LCDG_CODE(slot);
+}
+
+/*
+ * Horizontal bar graph across a whole row
+ * 5 steps per cell: 80 levels on a 16-column display, 200 on 40.
+ *
+ * @param row: Row number
+ * @param value: Bar length, 0 (empty) to 255 (full row)
+ */
+void lcd_bargraph(unsigned char row, unsigned char value)
+{
+    unsigned char px;
+    unsigned char part;
+    unsigned char col;
+
+    /* Pixel columns lit: (value + 1) * cols * 5 / 256, 255 = full row */
+    px = (((unsigned int)value + 1) * (LCD_COLS * 5)) >> 8;
+
+    part = ' ';
+    col = px;
+    while (col >= 5) col -= 5;
+    if (col) part = lcdg_get(LCDG_BAR[col - 1]);
+
+    _LCDG_GOTO(row, 0);
+    for (col = 0; col < LCD_COLS; col++) {
+        if (px >= 5) {
+            _LCDG_PUT(LCDG_FULL);
+            px -= 5;
+        } else {
+            _LCDG_PUT(part);
+            part = ' ';
+            px = 0;
+        }
+    }
+}
+
+/* Character codes for the big digit pieces (blank, full, top, bottom, both) */
+static void _lcdg_big_codes(unsigned char *map)
+{
+    map[0] = ' ';
+    map[1] = LCDG_FULL;
+    map[2] = lcdg_get(LCDG_BIG[0]);
+    map[3] = lcdg_get(LCDG_BIG[1]);
+    map[4] = lcdg_get(LCDG_BIG[2]);
+}
+
+/* Draw one big digit (anything but 0-9 is blank) */
+static void _lcdg_big_draw(unsigned char row, unsigned char col,
+                           unsigned char d, unsigned char *map)
+{
+    unsigned char i;
+    __code unsigned char *p = _LCDG_DIGITS[d > 9 ? 0 : d];
+
+    _LCDG_GOTO(row, col);
+    for (i = 0; i < 3; i++) _LCDG_PUT(d > 9 ? ' ' : map[p[i]]);
+    _LCDG_GOTO(row + 1, col);
+    for (i = 3; i < 6; i++) _LCDG_PUT(d > 9 ? ' ' : map[p[i]]);
+}
+
+/*
+ * Draw one big digit, 3 columns x 2 rows
+ *
+ * @param row: Top row
+ * @param col: Left column
+ * @param d: Digit 0-9 (other values draw a blank)
+ */
+void lcd_bigdigit(unsigned char row, unsigned char col, unsigned char d)
+{
+    unsigned char map[5];
+
+    _lcdg_big_codes(map);
+    _lcdg_big_draw(row, col, d, map);
+}
+
+/*
+ * Draw a number in big digits, right-aligned, one blank column between
+ * digits (width digits take width * 4 - 1 columns)
+ *
+ * @param row: Top row
+ * @param col: Left column
+ * @param num: Value
+ * @param width: Digits (leading positions blank)
+ */
+void lcd_bignum(unsigned char row, unsigned char col, unsigned int num,
+                unsigned char width)
+{
+    unsigned char map[5];
+    unsigned char i;
+    char *s;
+
+    _lcdg_big_codes(map);
+    s = numfmt_u16(num, width, ' ');
+
+    for (i = 0; s[i]; i++) {
+        if (i) {
+            _LCDG_GOTO(row, col);
+            _LCDG_PUT(' ');
+            _LCDG_GOTO(row + 1, col);
+            _LCDG_PUT(' ');
+            col++;
+        }
+        _lcdg_big_draw(row, col, s[i] - '0', map);
+        col += 3;
+    }
+}
+
+#endif /* LCDGLYPH_H */
@@ -0,0 +1,195 @@
+/*
+ * lcdq.h - Background LCD Refresh
+ * 8051 Bootcamp Shared Library
+ *
+ * Timer 0 interrupt that sends lcdfb.h's dirty cells to the LCD, one
+ * byte (a cursor move or a character) per tick. The tick is longer than
+ * the HD44780's 37us execution time, so nothing ever waits on the
+ * display: drawing calls return as soon as RAM is updated.
+ *
+ * Usage:
+ *   1. Optional configuration, then include *instead of* lcdfb.h:
+ *      #define LCDQ_TICK_US  200      Time between LCD writes (default 200)
+ *      #define LCDQ_SCAN     4        Scan steps per tick (default 4)
+ *      #include "../../lib/lcdq.h"    (includes lcdfb.h and lcd.h)
+ *
+ *   2. lcd_init(); lcdfb_init(); lcdq_init();
+ *      Then draw with lcdfb_puts_at() etc. - no flush needed
+ *      (lcdfb_flush() compiles to nothing).
+ *
+ * Timer 0 runs in mode 2 (8-bit auto-reload) and is stopped whenever
+ * nothing is dirty, so an unchanged screen costs no CPU at all. Each
+ * tick looks at no more than LCDQ_SCAN steps of the dirty map (a step
+ * is one cell, or 8 clean cells at once) and carries on from there next
+ * tick, so the ISR's length does not grow with the panel. A changed
+ * cell reaches the screen within 2 ticks once the scan gets to it; a
+ * full screen takes 34 ticks on a 16x2. tests/sim/lcdq_isr.c measures
+ * the longest tick in s51 and checks it against LCDQ_TICK_US.
+ *
+ * Timer 0 is taken: delay_ms() becomes the software loop
+ * (DELAY_NO_TIMER), and systick must use Timer 2. Do not call lcd_xxx()
+ * directly after lcdq_init() - the ISR owns the bus. CLEAR/HOME are not
+ * needed; use lcdfb_clear().
+ */
+
+#ifndef LCDQ_H
+#define LCDQ_H
+
+#include <8052.h>
+
+#if defined(DELAY_H) && !defined(DELAY_NO_TIMER)
+#error "lcdq.h needs Timer 0: define DELAY_NO_TIMER before including delay.h"
+#endif
+
+#if defined(SYSTICK_H) && SYSTICK_TIMER == 0
+#error "lcdq.h needs Timer 0: use SYSTICK_TIMER 2"
+#endif
+
+#if defined(SEG7_H) && defined(SEG7_ISR) && SEG7_TIMER == 0
+#error "seg7.h and lcdq.h both need Timer 0: use SEG7_TIMER 1"
+#endif
+
+#if defined(KEYPAD_H) && KEYPAD_TIMER == 0
+#error "keypad.h and lcdq.h both need Timer 0: use KEYPAD_TIMER 1"
+#endif
+
+#if defined(BUTTON_H) && BUTTON_TIMER == 0
+#error "button.h and lcdq.h both need Timer 0: use BUTTON_TIMER 1"
+#endif
+
+#ifndef DELAY_NO_TIMER
+#define DELAY_NO_TIMER
+#endif
+
+#ifndef LCDQ_TICK_US
+#define LCDQ_TICK_US    200
+#endif
+
+#ifndef LCDQ_SCAN
+#define LCDQ_SCAN       4
+#endif
+
+/* Tick in machine cycles (F_CPU / 12 per second), at most 256 */
+#define _LCDQ_CYCLES    ((F_CPU / 12000UL) * LCDQ_TICK_US / 1000UL)
+
+#define LCDFB_KICK()    (TR0 = 1)
+#define LCDFB_NO_FLUSH
+#include "lcdfb.h"
+
+#if _LCDQ_CYCLES > 256
+#error "LCDQ_TICK_US too long for Timer 0 mode 2 at this F_CPU"
+#endif
+
+#if LCDQ_TICK_US < 40
+#error "LCDQ_TICK_US too short: the LCD needs 37us per write"
+#endif
+
+#if LCDQ_SCAN < 1 || LCDQ_SCAN > 32
+#error "LCDQ_SCAN must be 1-32"
+#endif
+
+/* Scan position of the ISR: cell index and its row/column */
+static unsigned char _lcdq_i, _lcdq_row, _lcdq_col;
+
+/* Cells still to be seen clean before the screen counts as done */
+static unsigned char _lcdq_left;
+
+/* Step scan position by n cells (n <= LCD_COLS), wrapping at the end */
+#define _LCDQ_ADVANCE(n)    do { \
+        _lcdq_i += (n); \
+        _lcdq_col += (n); \
+        if (_lcdq_col >= LCD_COLS) { \
+            _lcdq_col -= LCD_COLS; \
+            if (++_lcdq_row == LCD_ROWS) { \
+                _lcdq_row = 0; _lcdq_col = 0; _lcdq_i = 0; \
+            } \
+        } \
+    } while (0)
+
+/*
+ * Timer 0 ISR - send one byte per tick
+ * Scans on from the last dirty cell sent, at most LCDQ_SCAN steps; moves
+ * the cursor to a dirty cell if needed (this tick) and writes the
+ * character (next tick). A whole lap of clean cells with no change made
+ * meanwhile (lcdfb_changed, cleared at the start of each lap) stops the
+ * timer.
+ */
+void lcdq_isr(void) __interrupt(1)
+{
+    unsigned char n = LCDQ_SCAN;
+    unsigned char d;
+
+    for (;;) {
+        if (!_lcdq_left) {
+            _lcdq_left = LCDFB_SIZE;
+            if (!lcdfb_changed) {
+                TR0 = 0;            /* Idle until the next change */
+                return;
+            }
+            lcdfb_changed = 0;      /* Something changed: one more lap */
+        }
+        if (!n) return;             /* Budget spent: go on next tick */
+        n--;
+
+        /* Whole clean byte at an 8-cell boundary: skip it at once */
+        if ((_lcdq_i & 7) == 0 && !lcdfb_dirty[_lcdq_i >> 3]
+                && _lcdq_i + 8 <= LCDFB_SIZE && _lcdq_left >= 8) {
+            _lcdq_left -= 8;
+            _LCDQ_ADVANCE(8);
+            continue;
+        }
+        if (lcdfb_dirty[_lcdq_i >> 3] & _LCDFB_BIT[_lcdq_i & 7]) break;
+        _lcdq_left--;
+        _LCDQ_ADVANCE(1);
+    }
+
+    /* A lap from here sees every cell changed before now */
+    _lcdq_left = LCDFB_SIZE;
+    lcdfb_changed = 0;
+
+    if (_lcdq_row != _lcdfb_row || _lcdq_col != _lcdfb_col) {
+        LCD_RS = 0;
+        _LCD_SELECT(_lcdq_row);
+        d = _LCD_ROW_ADDR(_lcdq_row) + _lcdq_col;
+        _LCD_PUT_BYTE(d);
+        _lcdfb_row = _lcdq_row;
+        _lcdfb_col = _lcdq_col;
+        return;
+    }
+
+    /* Clear first: a change made after this point marks it again */
+    lcdfb_dirty[_lcdq_i >> 3] &= ~_LCDFB_BIT[_lcdq_i & 7];
+    LCD_RS = 1;
+    d = lcdfb_buf[_lcdq_i];
+    _LCD_PUT_BYTE(d);
+
+    _lcdfb_col++;
+    _LCDQ_ADVANCE(1);
+}
+
+/*
+ * Start background refresh
+ * Call after lcd_init() and lcdfb_init(); enables ET0 and EA.
+ */
+void lcdq_init(void)
+{
+    TR0 = 0;
+    TMOD = (TMOD & 0xF0) | 0x02;    /* Timer 0, Mode 2 (8-bit auto-reload) */
+    TH0 = 256 - _LCDQ_CYCLES;
+    TL0 = TH0;
+    _lcdq_i = _lcdq_row = _lcdq_col = 0;
+    _lcdq_left = LCDFB_SIZE;
+    ET0 = 1;
+    EA = 1;
+    if (lcdfb_changed) TR0 = 1;
+}
+
+/*
+ * Wait until every change has reached the LCD
+ */
+void lcdq_sync(void)
+{
+    while (TR0);
+}
+
+#endif /* LCDQ_H */
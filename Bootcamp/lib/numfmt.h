@@ -0,0 +1,234 @@
+/*
+ * numfmt.h - Division-Free Number Formatting
+ * 8051 Bootcamp Shared Library
+ *
+ * Usage: #include "../lib/numfmt.h"
+ *
+ * Converts 8/16/32-bit values to text by subtracting powers of ten,
+ * never calling SDCC's _divuint/_moduint/_divulong/_modulong helpers.
+ * Every routine returns a pointer into a shared buffer (numfmt_buf),
+ * valid until the next numfmt call; numfmt_len holds its length.
+ *
+ *   width: minimum field width (0 = as short as possible, max 11)
+ *   pad:   ' ' for right-aligned text, '0' for zero padding
+ *          ("-0042" keeps the sign in front of the zeros)
+ *
+ * Cost against the /10 %10 loops: Module_06 05_numfmt_benchmark.c
+ * measures both.
+ */
+
+#ifndef NUMFMT_H
+#define NUMFMT_H
+
+#define NUMFMT_SIZE     12      /* "-2147483648" + NUL */
+#define _NUMFMT_END     (NUMFMT_SIZE - 1)
+
+char numfmt_buf[NUMFMT_SIZE];
+unsigned char numfmt_len;
+
+__code unsigned int NUMFMT_POW10_16[] = {10000, 1000, 100, 10};
+
+__code unsigned long NUMFMT_POW10_32[] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL
+};
+
+__code char NUMFMT_HEX[] = "0123456789ABCDEF";
+
+/*
+ * Drop leading zeros (keeping one digit), then apply sign and width
+ *
+ * @param i: Index of the first written digit
+ * @return: Pointer to the finished string
+ */
+static char *_numfmt_finish(unsigned char i, unsigned char neg,
+                            unsigned char width, char pad)
+{
+    while (i < _NUMFMT_END - 1 && numfmt_buf[i] == '0') i++;
+
+    if (width > _NUMFMT_END) width = _NUMFMT_END;
+
+    if (neg && pad != '0') {
+        numfmt_buf[--i] = '-';
+        neg = 0;
+    }
+    if (neg && width) width--;
+
+    while (_NUMFMT_END - i < width) numfmt_buf[--i] = pad;
+
+    if (neg) numfmt_buf[--i] = '-';
+
+    numfmt_len = _NUMFMT_END - i;
+    return &numfmt_buf[i];
+}
+
+/* Write 3 digits of v ending at _NUMFMT_END; returns first index */
+static unsigned char _numfmt_digits8(unsigned char v)
+{
+    unsigned char d;
+
+    numfmt_buf[_NUMFMT_END] = '\0';
+
+    d = '0';
+    while (v >= 100) { v -= 100; d++; }
+    numfmt_buf[_NUMFMT_END - 3] = d;
+
+    d = '0';
+    while (v >= 10) { v -= 10; d++; }
+    numfmt_buf[_NUMFMT_END - 2] = d;
+
+    numfmt_buf[_NUMFMT_END - 1] = '0' + v;
+    return _NUMFMT_END - 3;
+}
+
+/* Write digits for NUMFMT_POW10_16[k..3] plus ones, starting at i */
+static void _numfmt_tail16(unsigned char i, unsigned int v, unsigned char k)
+{
+    unsigned int p;
+    char d;
+
+    for (; k < 4; k++) {
+        p = NUMFMT_POW10_16[k];
+        d = '0';
+        while (v >= p) { v -= p; d++; }
+        numfmt_buf[i++] = d;
+    }
+    numfmt_buf[i++] = '0' + v;
+    numfmt_buf[i] = '\0';
+}
+
+/* Write 5 digits of v ending at _NUMFMT_END; returns first index */
+static unsigned char _numfmt_digits16(unsigned int v)
+{
+    if (v < 256) {
+        numfmt_buf[_NUMFMT_END - 5] = '0';
+        numfmt_buf[_NUMFMT_END - 4] = '0';
+        _numfmt_digits8(v);
+    } else {
+        _numfmt_tail16(_NUMFMT_END - 5, v, 0);
+    }
+    return _NUMFMT_END - 5;
+}
+
+/* Write 10 digits of v ending at _NUMFMT_END; returns first index */
+static unsigned char _numfmt_digits32(unsigned long v)
+{
+    unsigned char i, k;
+    unsigned long p;
+    char d;
+
+    i = _NUMFMT_END - 10;
+    for (k = 0; k < 6; k++) {
+        if (v <= 0xFFFF) {
+            /* Rest fits in 16 bits: zero-fill and finish on the fast path */
+            while (i < _NUMFMT_END - 5) numfmt_buf[i++] = '0';
+            _numfmt_digits16((unsigned int)v);
+            return _NUMFMT_END - 10;
+        }
+        p = NUMFMT_POW10_32[k];
+        d = '0';
+        while (v >= p) { v -= p; d++; }
+        numfmt_buf[i++] = d;
+    }
+
+    /* v < 10000: thousands down to ones */
+    _numfmt_tail16(i, (unsigned int)v, 1);
+    return _NUMFMT_END - 10;
+}
+
+/*
+ * Unsigned decimal
+ *
+ * @param v: Value
+ * @param width: Minimum field width
+ * @param pad: Fill character
+ * @return: Formatted string
+ */
+char *numfmt_u8(unsigned char v, unsigned char width, char pad)
+{
+    return _numfmt_finish(_numfmt_digits8(v), 0, width, pad);
+}
+
+char *numfmt_u16(unsigned int v, unsigned char width, char pad)
+{
+    return _numfmt_finish(_numfmt_digits16(v), 0, width, pad);
+}
+
+char *numfmt_u32(unsigned long v, unsigned char width, char pad)
+{
+    return _numfmt_finish(_numfmt_digits32(v), 0, width, pad);
+}
+
+/*
+ * Signed decimal
+ *
+ * @param v: Value
+ * @param width: Minimum field width (includes the sign)
+ * @param pad: Fill character
+ * @return: Formatted string
+ */
+char *numfmt_s8(signed char v, unsigned char width, char pad)
+{
+    unsigned char neg = v < 0;
+    return _numfmt_finish(_numfmt_digits8(neg ? -(unsigned char)v : v),
+                          neg, width, pad);
+}
+
+char *numfmt_s16(signed int v, unsigned char width, char pad)
+{
+    unsigned char neg = v < 0;
+    return _numfmt_finish(_numfmt_digits16(neg ? -(unsigned int)v : v),
+                          neg, width, pad);
+}
+
+char *numfmt_s32(signed long v, unsigned char width, char pad)
+{
+    unsigned char neg = v < 0;
+    return _numfmt_finish(_numfmt_digits32(neg ? -(unsigned long)v : v),
+                          neg, width, pad);
+}
+
+/*
+ * Hexadecimal (upper case, no prefix)
+ * Use width 2/4/8 with pad '0' for fixed-size output.
+ *
+ * @param v: Value
+ * @param width: Minimum field width
+ * @param pad: Fill character
+ * @return: Formatted string
+ */
+char *numfmt_hex32(unsigned long v, unsigned char width, char pad)
+{
+    unsigned char i = _NUMFMT_END;
+
+    numfmt_buf[i] = '\0';
+    do {
+        numfmt_buf[--i] = NUMFMT_HEX[(unsigned char)v & 0x0F];
+        v >>= 4;
+    } while (v);
+
+    return _numfmt_finish(i, 0, width, pad);
+}
+
+char *numfmt_hex16(unsigned int v, unsigned char width, char pad)
+{
+    unsigned char i = _NUMFMT_END;
+
+    numfmt_buf[i] = '\0';
+    do {
+        numfmt_buf[--i] = NUMFMT_HEX[v & 0x0F];
+        v >>= 4;
+    } while (v);
+
+    return _numfmt_finish(i, 0, width, pad);
+}
+
+char *numfmt_hex8(unsigned char v, unsigned char width, char pad)
+{
+    numfmt_buf[_NUMFMT_END] = '\0';
+    numfmt_buf[_NUMFMT_END - 1] = NUMFMT_HEX[v & 0x0F];
+    numfmt_buf[_NUMFMT_END - 2] = NUMFMT_HEX[v >> 4];
+
+    return _numfmt_finish(_NUMFMT_END - 2, 0, width, pad);
+}
+
+#endif /* NUMFMT_H */
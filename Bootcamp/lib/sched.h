@@ -0,0 +1,208 @@
+/*
+ * sched.h - Cooperative Task Scheduler
+ * 8051 Bootcamp Shared Library
+ *
+ * Run-to-completion scheduler on top of systick.h. Tasks are plain
+ * void functions that do a little work and return; they never block.
+ *
+ * Usage:
+ *   1. Give the task count, include, then define the task table:
+ *      #define SCHED_NUM_TASKS 3
+ *      #include "../../lib/sched.h"
+ *
+ *      __code sched_task_t sched_tasks[SCHED_NUM_TASKS] = {
+ *          { task_keypad, 10 },    periodic, every 10ms
+ *          { task_ui,      0 },    event-triggered only
+ *          { task_blink, 500 }
+ *      };
+ *
+ *   2. systick_init(); sched_init(); then call sched_run() forever.
+ *
+ * Table order is priority order: each sched_run() pass checks the
+ * tasks from index 0 upward. A task becomes ready when
+ *   - its period has elapsed (period != 0), or
+ *   - sched_signal() was called for it (safe from an ISR), or
+ *   - a sched_defer() timeout has passed.
+ *
+ * Per-task worst-case execution time, in machine cycles, is kept in
+ * sched_wcet[] (define SCHED_NO_PROFILE to leave it out).
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "systick.h"
+
+#ifndef SCHED_NUM_TASKS
+#error "Define SCHED_NUM_TASKS before including sched.h"
+#endif
+
+#if SCHED_NUM_TASKS > 8
+#error "SCHED_NUM_TASKS must be 8 or less"
+#endif
+
+typedef void (*sched_fn_t)(void);
+
+typedef struct {
+    sched_fn_t fn;          /* Task body (runs to completion) */
+    unsigned int period;    /* Period in ms, 0 = event-triggered */
+} sched_task_t;
+
+/* Task table, defined by the application in __code */
+extern __code sched_task_t sched_tasks[SCHED_NUM_TASKS];
+
+/* Per-task state */
+systick_t sched_next[SCHED_NUM_TASKS];  /* Next timed run */
+unsigned char sched_armed;              /* Bit n: sched_next[n] valid */
+volatile unsigned char sched_pending;   /* Bit n: signalled */
+unsigned char sched_current;            /* Task being run */
+unsigned char sched_signalled;          /* 1 if it was signalled */
+
+#ifndef SCHED_NO_PROFILE
+unsigned long sched_wcet[SCHED_NUM_TASKS];  /* Worst case, cycles */
+#endif
+
+/*
+ * Initialize scheduler
+ * Periodic tasks are due one period after this call.
+ * Call after systick_init().
+ */
+void sched_init(void)
+{
+    unsigned char i;
+    systick_t now = millis();
+
+    sched_armed = 0;
+    sched_pending = 0;
+
+    for (i = 0; i < SCHED_NUM_TASKS; i++) {
+        if (sched_tasks[i].period) {
+            sched_next[i] = now + sched_tasks[i].period;
+            sched_armed |= (1 << i);
+        }
+#ifndef SCHED_NO_PROFILE
+        sched_wcet[i] = 0;
+#endif
+    }
+}
+
+/*
+ * Mark task ready to run (event trigger)
+ * Single ORL on a data byte, so it is safe from ISRs.
+ *
+ * @param id: Task index
+ */
+#define sched_signal(id)    (sched_pending |= (1 << (id)))
+
+/*
+ * Run task once after a timeout
+ * For a periodic task this moves its next run instead.
+ *
+ * @param id: Task index
+ * @param ms: Delay in milliseconds
+ */
+void sched_defer(unsigned char id, systick_t ms)
+{
+    sched_next[id] = systick_deadline(ms);
+    sched_armed |= (1 << id);
+}
+
+/*
+ * Cancel a pending timeout or signal
+ * Periodic tasks are re-armed at their next period.
+ *
+ * @param id: Task index
+ */
+void sched_cancel(unsigned char id)
+{
+    unsigned char mask = ~(1 << id);
+
+    sched_pending &= mask;
+    if (sched_tasks[id].period) {
+        sched_next[id] = systick_deadline(sched_tasks[id].period);
+    } else {
+        sched_armed &= mask;
+    }
+}
+
+/*
+ * Run every ready task once, in table order
+ * Call repeatedly from the main loop.
+ */
+void sched_run(void)
+{
+    unsigned char i;
+    unsigned char mask;
+    unsigned int period;
+#ifndef SCHED_NO_PROFILE
+    systick_t ms0;
+    unsigned int cnt0;
+    unsigned long cycles;
+#endif
+
+    for (i = 0, mask = 1; i < SCHED_NUM_TASKS; i++, mask <<= 1) {
+        sched_signalled = (sched_pending & mask) != 0;
+
+        if (!sched_signalled) {
+            if (!(sched_armed & mask)) continue;
+            if (!systick_expired(sched_next[i])) continue;
+        }
+
+        sched_pending &= ~mask;
+        period = sched_tasks[i].period;
+
+        if (period && (sched_armed & mask) && systick_expired(sched_next[i])) {
+            /* Fixed rate; resync if we fell more than a period behind */
+            sched_next[i] += period;
+            if (systick_expired(sched_next[i]))
+                sched_next[i] = systick_deadline(period);
+        } else if (!period && !sched_signalled) {
+            sched_armed &= ~mask;   /* One-shot timeout consumed */
+        }
+
+        sched_current = i;
+
+#ifndef SCHED_NO_PROFILE
+        systick_snapshot();
+        ms0 = systick_snap_ms;
+        cnt0 = systick_snap_cnt;
+#endif
+
+        sched_tasks[i].fn();
+
+#ifndef SCHED_NO_PROFILE
+        systick_snapshot();
+        cycles = (unsigned long)(systick_t)(systick_snap_ms - ms0) * SYSTICK_PERIOD
+               + (signed int)(systick_snap_cnt - cnt0);
+        if (cycles > sched_wcet[i])
+            sched_wcet[i] = cycles;
+#endif
+    }
+}
+
+#ifndef SCHED_NO_PROFILE
+
+/*
+ * Worst-case execution time of a task
+ *
+ * @param id: Task index
+ * @return: Longest observed run, in machine cycles
+ */
+unsigned long sched_max_cycles(unsigned char id)
+{
+    return sched_wcet[id];
+}
+
+/*
+ * Clear worst-case statistics
+ */
+void sched_reset_stats(void)
+{
+    unsigned char i;
+    for (i = 0; i < SCHED_NUM_TASKS; i++)
+        sched_wcet[i] = 0;
+}
+
+#endif /* SCHED_NO_PROFILE */
+
+#endif /* SCHED_H */
@@ -0,0 +1,335 @@
+/*
+ * seg7.h - Multiplexed 7-Segment Display
+ * 8051 Bootcamp Shared Library
+ *
+ * Usage:
+ *   1. Optional configuration before including:
+ *      #define SEG7_SEGMENTS   P1      Segment port a-g, dp (default P1)
+ *      #define SEG7_DIGITS     P2      Digit select port (default P2)
+ *      #define SEG7_NUM_DIGITS 4       Digits, 1-8 (default 4)
+ *      #define SEG7_ACTIVE_LOW         Segments light on 0 (common anode)
+ *      #include "../../lib/seg7.h"
+ *
+ *   2. seg7_init(); then write patterns into seg7_buf[] (leftmost digit
+ *      first) and call seg7_refresh() continuously.
+ *
+ * Interrupt-driven multiplexing (main loop only writes seg7_buf[]):
+ *   #define SEG7_ISR
+ *   #define SEG7_TIMER      0       Timer 0 (default) or 1
+ *   #define SEG7_SLOT_US    1000    Time per digit (default 1000)
+ *   #define SEG7_BLINK_MS   250     Blink half-period (default 250)
+ *   seg7_init() starts the timer; seg7_refresh() compiles to nothing.
+ *
+ *   seg7_bright(digit, level)   0 (off) to SEG7_LEVELS (8, full)
+ *   seg7_blank                  Bit n = 1: digit n dark
+ *   seg7_blink                  Bit n = 1: digit n flashes
+ *
+ *   Each digit gets one interrupt to light it and one to switch it off
+ *   after level/8 of its slot (none at full brightness), so the CPU load
+ *   is about 2 x 50 cycles per slot - roughly 10% at the default 1ms
+ *   slot and 11.0592MHz (estimated), whatever the brightness. The frame rate is
+ *   1 / (SEG7_SLOT_US x digits): 250Hz for 4 digits.
+ *
+ *   SEG7_TIMER 0 needs DELAY_NO_TIMER (delay_ms() then uses the software
+ *   loop) and rules out lcdq.h and SYSTICK_TIMER 0; SEG7_TIMER 1 rules
+ *   out uart.h on Timer 1 (UART_BAUD_GEN 2 is fine). Either include
+ *   order is caught.
+ *
+ * Digit n is selected by driving bit n of SEG7_DIGITS low; the whole
+ * port is written, so keep other loads off it.
+ *
+ * Segment bits: a = 0x01, b = 0x02 ... g = 0x40, dp = 0x80
+ */
+
+#ifndef SEG7_H
+#define SEG7_H
+
+#include <8052.h>
+
+#ifndef SEG7_SEGMENTS
+#define SEG7_SEGMENTS   P1
+#endif
+
+#ifndef SEG7_DIGITS
+#define SEG7_DIGITS     P2
+#endif
+
+#ifndef SEG7_NUM_DIGITS
+#define SEG7_NUM_DIGITS 4
+#endif
+
+#ifndef SEG7_HOLD_US
+#define SEG7_HOLD_US    500     /* On-time per digit in seg7_refresh() */
+#endif
+
+#if SEG7_NUM_DIGITS < 1 || SEG7_NUM_DIGITS > 8
+#error "SEG7_NUM_DIGITS must be 1-8"
+#endif
+
+#if SEG7_HOLD_US > 25500
+#error "SEG7_HOLD_US must be 25500 or less"
+#endif
+
+/* Hold is done in pieces short enough for delay_us() at any F_CPU */
+#define _SEG7_HOLD_STEP 100
+
+#ifdef SEG7_ISR
+
+#ifndef SEG7_TIMER
+#define SEG7_TIMER      0
+#endif
+
+#ifndef SEG7_SLOT_US
+#define SEG7_SLOT_US    1000
+#endif
+
+#ifndef SEG7_BLINK_MS
+#define SEG7_BLINK_MS   250
+#endif
+
+#define SEG7_LEVELS     8
+
+#if SEG7_TIMER == 0
+#if defined(DELAY_H) && !defined(DELAY_NO_TIMER)
+#error "seg7.h with SEG7_TIMER 0: define DELAY_NO_TIMER before including delay.h"
+#endif
+#ifdef LCDQ_H
+#error "seg7.h and lcdq.h both need Timer 0: use SEG7_TIMER 1"
+#endif
+#if defined(SYSTICK_H) && SYSTICK_TIMER == 0
+#error "seg7.h with SEG7_TIMER 0: Timer 0 is the systick timer"
+#endif
+#if defined(KEYPAD_H) && KEYPAD_TIMER == 0
+#error "seg7.h and keypad.h both use Timer 0"
+#endif
+#if defined(BUTTON_H) && BUTTON_TIMER == 0
+#error "seg7.h and button.h both use Timer 0"
+#endif
+#ifndef DELAY_NO_TIMER
+#define DELAY_NO_TIMER
+#endif
+#define _SEG7_TH        TH0
+#define _SEG7_TL        TL0
+#define _SEG7_TR        TR0
+#define _SEG7_ET        ET0
+#define _SEG7_IRQ       1
+#define _SEG7_TMOD()    (TMOD = (TMOD & 0xF0) | 0x01)   /* Mode 1, 16-bit */
+#elif SEG7_TIMER == 1
+#if defined(UART_H) && UART_BAUD_GEN == 1
+#error "seg7.h with SEG7_TIMER 1: Timer 1 is the UART baud clock (use UART_BAUD_GEN 2)"
+#endif
+#if defined(KEYPAD_H) && KEYPAD_TIMER == 1
+#error "seg7.h and keypad.h both use Timer 1"
+#endif
+#if defined(BUTTON_H) && BUTTON_TIMER == 1
+#error "seg7.h and button.h both use Timer 1"
+#endif
+#define _SEG7_TH        TH1
+#define _SEG7_TL        TL1
+#define _SEG7_TR        TR1
+#define _SEG7_ET        ET1
+#define _SEG7_IRQ       3
+#define _SEG7_TMOD()    (TMOD = (TMOD & 0x0F) | 0x10)   /* Mode 1, 16-bit */
+#else
+#error "SEG7_TIMER must be 0 or 1"
+#endif
+
+#endif /* SEG7_ISR */
+
+#include "delay.h"              /* F_CPU, delay_us() */
+
+#ifdef SEG7_ISR
+
+/* Slot in machine cycles, and the frames per blink half-period */
+#define _SEG7_SLOT      ((F_CPU / 12000UL) * SEG7_SLOT_US / 1000UL)
+#define _SEG7_BLINK_FRAMES  (SEG7_BLINK_MS * 1000UL / (SEG7_SLOT_US * SEG7_NUM_DIGITS))
+
+#if _SEG7_SLOT / SEG7_LEVELS < 100 || _SEG7_SLOT > 65535
+#error "SEG7_SLOT_US out of range: level 1 needs >= 100 cycles, 16-bit timer"
+#endif
+
+#if _SEG7_BLINK_FRAMES < 1 || _SEG7_BLINK_FRAMES > 255
+#error "SEG7_BLINK_MS out of range for this slot time"
+#endif
+
+#endif /* SEG7_ISR */
+
+#ifdef SEG7_ACTIVE_LOW
+#define _SEG7_OUT(p)    (SEG7_SEGMENTS = ~(p))
+#else
+#define _SEG7_OUT(p)    (SEG7_SEGMENTS = (p))
+#endif
+
+#define SEG7_DP         0x80
+#define SEG7_BLANK      0x00
+
+/*
+ * Character patterns, ' ' (0x20) to '_' (0x5F); lowercase is folded.
+ * Letters are the usual 7-segment approximations (b, d, n, r, t, u
+ * lowercase shapes); '*' is a degree sign. Unsupported glyphs are blank.
+ */
+__code unsigned char SEG7_FONT[64] = {
+    0x00, 0x86, 0x22, 0x00, 0x00, 0x00, 0x00, 0x02,   /*  !"#$%&' */
+    0x39, 0x0F, 0x63, 0x00, 0x00, 0x40, 0x80, 0x52,   /* ()*+,-./ */
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,   /* 01234567 */
+    0x7F, 0x6F, 0x00, 0x00, 0x00, 0x48, 0x00, 0x53,   /* 89:;<=>? */
+    0x00, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x3D,   /* @ABCDEFG */
+    0x76, 0x30, 0x1E, 0x75, 0x38, 0x37, 0x54, 0x3F,   /* HIJKLMNO */
+    0x73, 0x67, 0x50, 0x6D, 0x78, 0x3E, 0x1C, 0x2A,   /* PQRSTUVW */
+    0x76, 0x6E, 0x5B, 0x39, 0x64, 0x0F, 0x23, 0x08    /* XYZ[\]^_ */
+};
+
+/* Digit select, active low */
+__code unsigned char _SEG7_SEL[8] = {
+    0xFE, 0xFD, 0xFB, 0xF7, 0xEF, 0xDF, 0xBF, 0x7F
+};
+
+unsigned char seg7_buf[SEG7_NUM_DIGITS];    /* Segment pattern per digit */
+
+/*
+ * Segment pattern for a character
+ *
+ * @param c: ASCII character
+ * @return: Pattern (a = bit 0 ... g = bit 6), 0 if not displayable
+ */
+unsigned char seg7_font(char c)
+{
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    if (c < ' ' || c > '_') return SEG7_BLANK;
+    return SEG7_FONT[c - ' '];
+}
+
+#ifdef SEG7_ISR
+
+unsigned char seg7_blank;       /* Bit n = 1: digit n dark */
+unsigned char seg7_blink;       /* Bit n = 1: digit n flashes */
+
+/* Timer reloads per digit: on-phase and off-phase, 0 = skip that phase */
+static unsigned int _seg7_on[SEG7_NUM_DIGITS];
+static unsigned int _seg7_off[SEG7_NUM_DIGITS];
+
+static unsigned char _seg7_i;       /* Digit in its slot */
+static unsigned char _seg7_hide;    /* Dark digits this frame */
+static unsigned char _seg7_frames;  /* Frames into the blink half-period */
+static __bit _seg7_lit;             /* Digit currently on */
+static __bit _seg7_blink_phase;     /* Blinking digits dark */
+
+#define _SEG7_LOAD(t)   do { _SEG7_TH = (unsigned char)((t) >> 8); _SEG7_TL = (unsigned char)(t); } while (0)
+
+/*
+ * Multiplex ISR
+ * Slot start: light the next digit for its on-time. On-time over: dark
+ * for the rest of the slot. Full and zero brightness skip a phase.
+ */
+void seg7_isr(void) __interrupt(_SEG7_IRQ)
+{
+    unsigned int t;
+
+    SEG7_DIGITS = 0xFF;
+
+    if (_seg7_lit) {
+        _seg7_lit = 0;
+        t = _seg7_off[_seg7_i];
+        if (t) {
+            _SEG7_LOAD(t);
+            return;
+        }
+    }
+
+    if (++_seg7_i == SEG7_NUM_DIGITS) {
+        _seg7_i = 0;
+        if (++_seg7_frames == _SEG7_BLINK_FRAMES) {
+            _seg7_frames = 0;
+            _seg7_blink_phase = !_seg7_blink_phase;
+        }
+        _seg7_hide = seg7_blank;
+        if (_seg7_blink_phase) _seg7_hide |= seg7_blink;
+    }
+
+    t = _seg7_on[_seg7_i];
+    if (t && !(_seg7_hide & ~_SEG7_SEL[_seg7_i])) {
+        _SEG7_OUT(seg7_buf[_seg7_i]);
+        SEG7_DIGITS = _SEG7_SEL[_seg7_i];
+        _seg7_lit = 1;
+        _SEG7_LOAD(t);
+    } else {
+        _SEG7_LOAD(65536UL - _SEG7_SLOT);
+    }
+}
+
+/*
+ * Set digit brightness
+ *
+ * @param digit: Digit number (0 = leftmost)
+ * @param level: 0 (off) to SEG7_LEVELS (full)
+ */
+void seg7_bright(unsigned char digit, unsigned char level)
+{
+    unsigned int on;
+
+    if (level > SEG7_LEVELS) level = SEG7_LEVELS;
+    on = (unsigned int)(_SEG7_SLOT / SEG7_LEVELS) * level;
+
+    _SEG7_ET = 0;
+    _seg7_on[digit] = on ? (unsigned int)(65536UL - on) : 0;
+    _seg7_off[digit] = (level == 0 || level == SEG7_LEVELS) ? 0 :
+                       (unsigned int)(65536UL - _SEG7_SLOT + on);
+    _SEG7_ET = 1;
+}
+
+#define seg7_refresh()          /* Done by the ISR */
+
+#endif /* SEG7_ISR */
+
+/*
+ * Blank all digits and switch the display off
+ * With SEG7_ISR: full brightness, no blink, multiplexing started.
+ */
+void seg7_init(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < SEG7_NUM_DIGITS; i++)
+        seg7_buf[i] = SEG7_BLANK;
+    SEG7_DIGITS = 0xFF;
+    _SEG7_OUT(SEG7_BLANK);
+
+#ifdef SEG7_ISR
+    _SEG7_TR = 0;
+    _SEG7_TMOD();
+    seg7_blank = 0;
+    seg7_blink = 0;
+    _seg7_i = SEG7_NUM_DIGITS - 1;      /* First interrupt starts digit 0 */
+    _seg7_lit = 0;
+    for (i = 0; i < SEG7_NUM_DIGITS; i++)
+        seg7_bright(i, SEG7_LEVELS);
+    _SEG7_LOAD(65536UL - _SEG7_SLOT);
+    _SEG7_ET = 1;
+    EA = 1;
+    _SEG7_TR = 1;
+#endif
+}
+
+#ifndef SEG7_ISR
+/*
+ * Show every digit once for SEG7_HOLD_US (call continuously)
+ */
+void seg7_refresh(void)
+{
+    unsigned char i, k;
+
+    for (i = 0; i < SEG7_NUM_DIGITS; i++) {
+        SEG7_DIGITS = 0xFF;         /* All off while segments change */
+        _SEG7_OUT(seg7_buf[i]);
+        SEG7_DIGITS = _SEG7_SEL[i];
+        for (k = SEG7_HOLD_US / _SEG7_HOLD_STEP; k; k--)
+            delay_us(_SEG7_HOLD_STEP);
+#if SEG7_HOLD_US % _SEG7_HOLD_STEP
+        delay_us(SEG7_HOLD_US % _SEG7_HOLD_STEP);
+#endif
+    }
+    SEG7_DIGITS = 0xFF;
+}
+#endif
+
+#endif /* SEG7_H */
@@ -0,0 +1,353 @@
+/*
+ * shell.h - Serial Command Shell
+ * 8051 Bootcamp Shared Library
+ *
+ * Line-editing command shell on the buffered UART. The serial ISR edits
+ * the line directly (via UART_RX_HOOK), so no keystroke is lost while
+ * the main loop is busy; shell_poll() echoes and runs complete lines.
+ *
+ * Usage:
+ *   1. Give the command count and include shell.h *instead of* uart.h
+ *      (it includes uart.h itself with UART_BUFFERED and the RX hook):
+ *      #define SHELL_NUM_CMDS  4
+ *      #define SHELL_LINE_SIZE 32          Line buffer (default 32)
+ *      #define SHELL_MAX_ARGS  4           Words per line (default 4)
+ *      #include "../../lib/shell.h"
+ *
+ *   2. Define the command table, sorted by name (strcmp order), so it
+ *      can be binary searched:
+ *      __code shell_cmd_t shell_cmds[SHELL_NUM_CMDS] = {
+ *          { "count", cmd_count, "Binary count on LEDs" },
+ *          { "help",  shell_help, "List commands" },
+ *          { "led",   cmd_led,   "led <value>" },
+ *          { "off",   cmd_off,   "All LEDs off" }
+ *      };
+ *
+ *   3. uart_init(); shell_init(); then call shell_poll() from the main loop.
+ *
+ * Commands:
+ *   unsigned char cmd(unsigned char argc)
+ *     argc counts the command name; shell_argv[1..] are the arguments
+ *     (shell_arg_num() parses decimal or 0x hex).
+ *     Return SHELL_DONE, or SHELL_BUSY to be called again on the next
+ *     shell_poll() - long jobs run a step at a time instead of blocking.
+ *     shell_first is 1 on the first call of a command, 0 on repeats.
+ *
+ * Keys: Backspace/DEL erase, Ctrl-U clears the line, Ctrl-C clears the
+ * line or stops a busy command. Input typed while a command is running
+ * is ignored.
+ *
+ * Lookup is a binary search over the __code table: about log2(n) name
+ * comparisons (6 for 50 commands) instead of one per command.
+ */
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#ifdef UART_H
+#error "Include shell.h instead of uart.h (it installs the UART RX hook)"
+#endif
+
+#ifndef SHELL_NUM_CMDS
+#error "Define SHELL_NUM_CMDS before including shell.h"
+#endif
+
+#ifndef SHELL_LINE_SIZE
+#define SHELL_LINE_SIZE     32
+#endif
+
+#ifndef SHELL_MAX_ARGS
+#define SHELL_MAX_ARGS      4
+#endif
+
+#ifndef SHELL_PROMPT
+#define SHELL_PROMPT        "> "
+#endif
+
+#if SHELL_NUM_CMDS > 254 || SHELL_LINE_SIZE > 255
+#error "SHELL_NUM_CMDS must be <= 254 and SHELL_LINE_SIZE <= 255"
+#endif
+
+#define SHELL_DONE          0
+#define SHELL_BUSY          1
+
+#define SHELL_NONE          0xFF    /* Lookup failed */
+
+#define _SHELL_CTRL_C       0x03
+#define _SHELL_CTRL_U       0x15
+
+/* Line state, edited by the serial ISR until shell_ready is set */
+char shell_line[SHELL_LINE_SIZE];
+volatile unsigned char shell_len;   /* Characters in the line */
+volatile unsigned char shell_low;   /* Shortest length since last echo */
+volatile __bit shell_ready;         /* Line complete, ISR stops editing */
+volatile __bit shell_abort;         /* Ctrl-C seen */
+
+/*
+ * Serial RX hook (called from the ISR for every byte)
+ */
+static void _shell_rx(unsigned char c)
+{
+    if (c == _SHELL_CTRL_C) {
+        shell_abort = 1;
+        c = _SHELL_CTRL_U;      /* Also clears a line being typed */
+    }
+
+    if (shell_ready) return;    /* Line (or its command) still in use */
+
+    if (c == '\r') {
+        shell_ready = 1;
+    } else if (c == '\b' || c == 0x7F) {
+        if (shell_len) {
+            shell_len--;
+            if (shell_len < shell_low) shell_low = shell_len;
+        }
+    } else if (c == _SHELL_CTRL_U) {
+        shell_len = 0;
+        shell_low = 0;
+    } else if (c >= ' ' && c < 0x7F && shell_len < SHELL_LINE_SIZE - 1) {
+        shell_line[shell_len++] = c;
+    }
+    /* '\n' and other control characters are ignored */
+}
+
+#define UART_BUFFERED
+#define UART_RX_HOOK(c)     _shell_rx(c)
+#include "uart.h"
+
+typedef unsigned char (*shell_fn_t)(unsigned char argc);
+
+typedef struct {
+    char *name;             /* Command word */
+    shell_fn_t fn;          /* Handler */
+    char *help;             /* One-line description */
+} shell_cmd_t;
+
+/* Command table, defined by the application in __code, sorted by name */
+extern __code shell_cmd_t shell_cmds[SHELL_NUM_CMDS];
+
+char *shell_argv[SHELL_MAX_ARGS];
+unsigned char shell_argc;
+__bit shell_first;                  /* First call of the running command */
+
+static unsigned char _shell_echoed; /* Characters shown on the terminal */
+static shell_fn_t _shell_busy;      /* Command asking to be called again */
+
+/*
+ * Compare two names (strcmp order)
+ *
+ * @return: <0, 0 or >0
+ */
+static signed char _shell_cmp(char *a, char *b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+/*
+ * Find command by name (binary search)
+ *
+ * @param name: Command word
+ * @return: Index into shell_cmds[], or SHELL_NONE
+ */
+unsigned char shell_find(char *name)
+{
+    unsigned char lo = 0;
+    unsigned char hi = SHELL_NUM_CMDS;
+    unsigned char mid;
+    signed char r;
+
+    while (lo < hi) {
+        mid = (lo + hi) >> 1;
+        r = _shell_cmp(name, shell_cmds[mid].name);
+        if (r == 0) return mid;
+        if (r < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return SHELL_NONE;
+}
+
+/*
+ * Parse numeric argument
+ * Accepts decimal ("200") or hex ("0xC8"), up to 65535.
+ *
+ * @param i: Argument index (1 = first argument)
+ * @param v: Receives the value
+ * @return: 1 if valid, 0 if missing or not a number
+ */
+unsigned char shell_arg_num(unsigned char i, unsigned int *v)
+{
+    char *s;
+    unsigned int n = 0;
+    unsigned char d;
+
+    if (i >= shell_argc) return 0;
+    s = shell_argv[i];
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        s += 2;
+        if (!*s) return 0;
+        while (*s) {
+            d = *s++;
+            if (d >= '0' && d <= '9') d -= '0';
+            else if ((d | 0x20) >= 'a' && (d | 0x20) <= 'f') d = (d | 0x20) - 'a' + 10;
+            else return 0;
+            if (n > 0x0FFF) return 0;
+            n = (n << 4) | d;
+        }
+    } else {
+        while (*s) {
+            d = *s++ - '0';
+            if (d > 9) return 0;
+            if (n > 6553 || (n == 6553 && d > 5)) return 0;
+            n = (n << 3) + (n << 1) + d;
+        }
+    }
+
+    *v = n;
+    return 1;
+}
+
+/* Release the line to the ISR and show a fresh prompt */
+static void _shell_done(void)
+{
+    _shell_busy = 0;
+    _shell_echoed = 0;
+    shell_len = 0;
+    shell_low = 0;
+    shell_ready = 0;
+    uart_puts(SHELL_PROMPT);
+}
+
+/* Split the line into words and run the command */
+static void _shell_exec(void)
+{
+    unsigned char i;
+    unsigned char id;
+    __bit in_word = 0;
+
+    shell_line[shell_len] = '\0';
+    shell_argc = 0;
+
+    for (i = 0; i < shell_len; i++) {
+        if (shell_line[i] == ' ') {
+            shell_line[i] = '\0';
+            in_word = 0;
+        } else if (!in_word && shell_argc < SHELL_MAX_ARGS) {
+            shell_argv[shell_argc++] = &shell_line[i];
+            in_word = 1;
+        }
+    }
+
+    if (shell_argc == 0) {
+        _shell_done();
+        return;
+    }
+
+    id = shell_find(shell_argv[0]);
+    if (id == SHELL_NONE) {
+        uart_puts("Unknown command: ");
+        uart_puts(shell_argv[0]);
+        uart_puts("\r\n");
+        _shell_done();
+        return;
+    }
+
+    shell_first = 1;
+    if (shell_cmds[id].fn(shell_argc) == SHELL_BUSY) {
+        _shell_busy = shell_cmds[id].fn;
+    } else {
+        _shell_done();
+    }
+}
+
+/*
+ * Built-in "help" command (add it to the table to use it)
+ */
+unsigned char shell_help(unsigned char argc)
+{
+    unsigned char i;
+    unsigned char n;
+    char *s;
+
+    (void)argc;
+    for (i = 0; i < SHELL_NUM_CMDS; i++) {
+        s = shell_cmds[i].name;
+        uart_puts(s);
+        for (n = 0; s[n]; n++);
+        for (; n < 10; n++) uart_tx(' ');
+        uart_puts(shell_cmds[i].help);
+        uart_puts("\r\n");
+    }
+    return SHELL_DONE;
+}
+
+/*
+ * Initialize shell and print the first prompt
+ * Call after uart_init(). Warns if the table is not sorted.
+ */
+void shell_init(void)
+{
+    unsigned char i;
+
+    for (i = 1; i < SHELL_NUM_CMDS; i++) {
+        if (_shell_cmp(shell_cmds[i - 1].name, shell_cmds[i].name) >= 0) {
+            uart_puts("shell: table not sorted at ");
+            uart_puts(shell_cmds[i].name);
+            uart_puts("\r\n");
+        }
+    }
+
+    shell_abort = 0;
+    _shell_done();
+}
+
+/*
+ * Service the shell: echo typing, run complete lines, step busy commands
+ * Call often from the main loop; returns quickly.
+ */
+void shell_poll(void)
+{
+    unsigned char len;
+    unsigned char low;
+    __bit ready;
+
+    if (shell_abort) {
+        shell_abort = 0;
+        uart_puts("^C\r\n");
+        _shell_done();
+        return;
+    }
+
+    if (_shell_busy) {
+        shell_first = 0;
+        if (_shell_busy(shell_argc) == SHELL_DONE)
+            _shell_done();
+        return;
+    }
+
+    /* Snapshot the ISR's view; ready first so no late keystroke is missed */
+    ES = 0;
+    ready = shell_ready;
+    len = shell_len;
+    low = shell_low;
+    shell_low = len;
+    ES = 1;
+
+    while (_shell_echoed > low) {
+        uart_puts("\b \b");
+        _shell_echoed--;
+    }
+    while (_shell_echoed < len)
+        uart_tx(shell_line[_shell_echoed++]);
+
+    if (ready) {
+        uart_puts("\r\n");
+        _shell_exec();
+    }
+}
+
+#endif /* SHELL_H */
@@ -0,0 +1,397 @@
+/*
+ * systick.h - 1ms System Tick Library
+ * 8051 Bootcamp Shared Library
+ *
+ * Usage:
+ *   1. Optional configuration before including:
+ *      #define F_CPU           11059200UL  Crystal frequency (Hz)
+ *      #define SYSTICK_TIMER   2           2 = Timer 2 (8052, default)
+ *                                          0 = Timer 0 (plain 8051)
+ *      #define SYSTICK_32BIT               32-bit millis() (default 16-bit)
+ *      #define SYSTICK_NUM_TIMERS 4        One-shot software timers (max 8)
+ *      #define SYSTICK_HOOK()  fn()        Called from the tick ISR every
+ *                                          ms, after systick_ms++ (see
+ *                                          extint.h)
+ *      #include "../../lib/systick.h"
+ *
+ *   2. Call systick_init() once; it enables the timer interrupt and EA.
+ *
+ * A 16-bit tick wraps every 65.5 seconds, a 32-bit tick every 49 days.
+ * All comparisons go through systick_elapsed()/systick_expired(), which
+ * are wraparound safe as long as an interval is shorter than half the
+ * counter range (32.7s for 16-bit).
+ */
+
+#ifndef SYSTICK_H
+#define SYSTICK_H
+
+#include <8052.h>
+
+#ifndef F_CPU
+#define F_CPU   11059200UL
+#endif
+
+#ifndef SYSTICK_TIMER
+#define SYSTICK_TIMER       2
+#endif
+
+#ifndef SYSTICK_NUM_TIMERS
+#define SYSTICK_NUM_TIMERS  4
+#endif
+
+#if SYSTICK_TIMER != 0 && SYSTICK_TIMER != 2
+#error "SYSTICK_TIMER must be 0 or 2"
+#endif
+
+#if SYSTICK_NUM_TIMERS > 8
+#error "SYSTICK_NUM_TIMERS must be 8 or less"
+#endif
+
+#ifndef SYSTICK_HOOK
+#define SYSTICK_HOOK()
+#endif
+
+#if SYSTICK_TIMER == 0 && defined(DELAY_H) && !defined(DELAY_NO_TIMER)
+#error "delay_ms() uses Timer 0: define DELAY_NO_TIMER or use SYSTICK_TIMER 2"
+#endif
+
+#if SYSTICK_TIMER == 2 && defined(CAPTURE_H)
+#error "Timer 2 is used by capture.h: use SYSTICK_TIMER 0"
+#endif
+
+#if SYSTICK_TIMER == 0 && defined(SEG7_H) && defined(SEG7_ISR) && SEG7_TIMER == 0
+#error "Timer 0 multiplexes seg7.h: use SYSTICK_TIMER 2 or SEG7_TIMER 1"
+#endif
+
+#if SYSTICK_TIMER == 0 && defined(KEYPAD_H) && KEYPAD_TIMER == 0
+#error "Timer 0 scans keypad.h: use SYSTICK_TIMER 2 or KEYPAD_TIMER 1"
+#endif
+
+#if SYSTICK_TIMER == 0 && defined(BUTTON_H) && BUTTON_TIMER == 0
+#error "Timer 0 samples button.h: use SYSTICK_TIMER 2 or BUTTON_TIMER 1"
+#endif
+
+#ifdef SYSTICK_32BIT
+typedef unsigned long systick_t;
+typedef signed long systick_diff_t;
+#else
+typedef unsigned int systick_t;
+typedef signed int systick_diff_t;
+#endif
+
+/*
+ * Machine cycles per millisecond = F_CPU / 12000, split into an integer
+ * period and a remainder (in 1/12000ths of a cycle). The remainder is
+ * accumulated so the long-term rate is exact even when the period is
+ * fractional (921.6 cycles at 11.0592MHz).
+ */
+#define SYSTICK_PERIOD      (F_CPU / 12000UL)
+#define SYSTICK_FRAC        (F_CPU % 12000UL)
+#define SYSTICK_RELOAD(p)   (65536UL - (p))
+
+/* Millisecond counter (written only by the ISR) */
+volatile systick_t systick_ms;
+
+#if SYSTICK_FRAC
+static unsigned int _systick_acc;
+#endif
+
+/* One-shot software timers: deadlines plus an "armed" bitmask */
+#if SYSTICK_NUM_TIMERS
+systick_t systick_deadline_tab[SYSTICK_NUM_TIMERS];
+unsigned char systick_armed;
+#endif
+
+#if SYSTICK_TIMER == 2
+
+/* Mask/unmask only the tick interrupt, EA is left alone */
+#define SYSTICK_LOCK()      (ET2 = 0)
+#define SYSTICK_UNLOCK()    (ET2 = 1)
+
+/*
+ * Timer 2 ISR - 1ms tick
+ * 16-bit auto-reload from RCAP2H/L: no reload latency, no drift.
+ * Writing RCAP2 selects the length of the *next* period.
+ */
+void systick_isr(void) __interrupt(5)
+{
+    TF2 = 0;    /* Not cleared by hardware */
+    systick_ms++;
+
+#if SYSTICK_FRAC
+    _systick_acc += SYSTICK_FRAC;
+    if (_systick_acc >= 12000) {
+        _systick_acc -= 12000;
+        RCAP2H = (SYSTICK_RELOAD(SYSTICK_PERIOD + 1) >> 8) & 0xFF;
+        RCAP2L = SYSTICK_RELOAD(SYSTICK_PERIOD + 1) & 0xFF;
+    } else {
+        RCAP2H = (SYSTICK_RELOAD(SYSTICK_PERIOD) >> 8) & 0xFF;
+        RCAP2L = SYSTICK_RELOAD(SYSTICK_PERIOD) & 0xFF;
+    }
+#endif
+
+    SYSTICK_HOOK();
+}
+
+/*
+ * Initialize system tick
+ * Timer 2 in 16-bit auto-reload mode, interrupt every 1ms
+ */
+void systick_init(void)
+{
+    T2CON = 0x00;       /* Auto-reload, timer mode, stopped */
+    RCAP2H = (SYSTICK_RELOAD(SYSTICK_PERIOD) >> 8) & 0xFF;
+    RCAP2L = SYSTICK_RELOAD(SYSTICK_PERIOD) & 0xFF;
+    TH2 = RCAP2H;
+    TL2 = RCAP2L;
+    systick_ms = 0;
+    ET2 = 1;            /* Enable Timer 2 interrupt */
+    EA = 1;             /* Global interrupt enable */
+    TR2 = 1;            /* Start Timer 2 */
+}
+
+#define SYSTICK_TH      TH2
+#define SYSTICK_TL      TL2
+#define SYSTICK_TF      TF2
+
+/* Count read with an overflow pending: already reloaded in hardware */
+#define SYSTICK_PENDING_CNT(c)  (c)
+
+#else /* SYSTICK_TIMER == 0 */
+
+#define SYSTICK_LOCK()      (ET0 = 0)
+#define SYSTICK_UNLOCK()    (ET0 = 1)
+
+/*
+ * Machine cycles Timer 0 is stopped while the period is added: from the
+ * end of CLR TR0 to the end of SETB TR0 in the asm block below, six
+ * one-cycle moves/adds plus the SETB itself (the MCS-51 User's Manual
+ * reload idiom). The block is written in asm so this does not depend
+ * on the compiler; tests/sim/systick_t0.c checks the tick rate in s51.
+ */
+#define SYSTICK_T0_FIXUP    7
+
+/* Amount added to TH0:TL0 by the ISR (direct RAM for ADD A,direct) */
+__data unsigned int _systick_t0_add;
+
+/*
+ * Timer 0 ISR - 1ms tick
+ * Mode 1 has no auto-reload, so the period is *added* to the count
+ * that accumulated since overflow. ISR entry latency is absorbed and
+ * only the short stopped window (SYSTICK_T0_FIXUP) is compensated.
+ */
+void systick_isr(void) __interrupt(1)
+{
+    unsigned int period = SYSTICK_PERIOD;
+
+#if SYSTICK_FRAC
+    _systick_acc += SYSTICK_FRAC;
+    if (_systick_acc >= 12000) {
+        _systick_acc -= 12000;
+        period++;
+    }
+#endif
+
+    _systick_t0_add = (unsigned int)SYSTICK_RELOAD(period) + SYSTICK_T0_FIXUP;
+
+    __asm
+        push    acc
+        push    psw
+        clr     _TR0                        ; Stopped after this
+        mov     a, _TL0                     ; 1
+        add     a, __systick_t0_add         ; 1
+        mov     _TL0, a                     ; 1
+        mov     a, _TH0                     ; 1
+        addc    a, (__systick_t0_add + 1)   ; 1
+        mov     _TH0, a                     ; 1
+        setb    _TR0                        ; 1 = SYSTICK_T0_FIXUP
+        pop     psw
+        pop     acc
+    __endasm;
+
+    systick_ms++;
+    SYSTICK_HOOK();
+}
+
+/*
+ * Initialize system tick
+ * Timer 0 in Mode 1 (16-bit), interrupt every 1ms
+ */
+void systick_init(void)
+{
+    TMOD = (TMOD & 0xF0) | 0x01;  /* Timer 0, Mode 1 */
+    TH0 = (SYSTICK_RELOAD(SYSTICK_PERIOD) >> 8) & 0xFF;
+    TL0 = SYSTICK_RELOAD(SYSTICK_PERIOD) & 0xFF;
+    systick_ms = 0;
+    ET0 = 1;            /* Enable Timer 0 interrupt */
+    EA = 1;             /* Global interrupt enable */
+    TR0 = 1;            /* Start Timer 0 */
+}
+
+#define SYSTICK_TH      TH0
+#define SYSTICK_TL      TL0
+#define SYSTICK_TF      TF0
+
+/*
+ * Count read with an overflow pending: the ISR has not added the
+ * period yet, so TH0:TL0 holds the cycles since the wrap. Add what the
+ * ISR will add (less the stopped window it makes up for).
+ */
+#define SYSTICK_PENDING_CNT(c)  ((c) + (unsigned int)SYSTICK_RELOAD(SYSTICK_PERIOD))
+
+#endif /* SYSTICK_TIMER */
+
+/*
+ * Read millisecond counter
+ * Multi-byte read is done with the tick interrupt masked.
+ *
+ * @return: Milliseconds since systick_init()
+ */
+systick_t millis(void)
+{
+    systick_t t;
+
+    SYSTICK_LOCK();
+    t = systick_ms;
+    SYSTICK_UNLOCK();
+
+    return t;
+}
+
+/* Last systick_snapshot() result */
+systick_t systick_snap_ms;
+unsigned int systick_snap_cnt;
+
+/*
+ * Capture millisecond counter and raw timer count together
+ * Used for sub-millisecond measurements: between two snapshots
+ *   cycles = (ms1 - ms0) * SYSTICK_PERIOD + (signed int)(cnt1 - cnt0)
+ * (every tick moves the count back by one period, modulo 65536)
+ */
+void systick_snapshot(void)
+{
+    unsigned char hi, lo;
+    unsigned int cnt;
+
+    SYSTICK_LOCK();
+    do {
+        hi = SYSTICK_TH;
+        lo = SYSTICK_TL;
+    } while (hi != SYSTICK_TH);
+    cnt = ((unsigned int)hi << 8) | lo;
+    systick_snap_ms = systick_ms;
+
+    /* Overflow pending while masked: count belongs to the next ms */
+    if (SYSTICK_TF) {
+        do {
+            hi = SYSTICK_TH;
+            lo = SYSTICK_TL;
+        } while (hi != SYSTICK_TH);
+        cnt = SYSTICK_PENDING_CNT(((unsigned int)hi << 8) | lo);
+        systick_snap_ms++;
+    }
+    SYSTICK_UNLOCK();
+
+    systick_snap_cnt = cnt;
+}
+
+/*
+ * Time since a previous millis() reading
+ *
+ * @param since: Earlier millis() value
+ * @return: Elapsed milliseconds (wraparound safe)
+ */
+systick_t systick_elapsed(systick_t since)
+{
+    return millis() - since;
+}
+
+/*
+ * Compute a deadline
+ *
+ * @param ms: Milliseconds from now
+ * @return: Deadline for systick_expired()
+ */
+systick_t systick_deadline(systick_t ms)
+{
+    return millis() + ms;
+}
+
+/*
+ * Check whether a deadline has passed
+ *
+ * @param deadline: Value from systick_deadline()
+ * @return: 1 if reached or passed, 0 otherwise (wraparound safe)
+ */
+unsigned char systick_expired(systick_t deadline)
+{
+    return (systick_diff_t)(millis() - deadline) >= 0;
+}
+
+/*
+ * Blocking wait (for setup code; use deadlines in main loops)
+ *
+ * @param ms: Milliseconds to wait
+ */
+void systick_wait(systick_t ms)
+{
+    systick_t deadline = systick_deadline(ms);
+    while (!systick_expired(deadline));
+}
+
+#if SYSTICK_NUM_TIMERS
+
+/*
+ * Arm one-shot software timer
+ * Restarting an armed timer moves its deadline.
+ *
+ * @param id: Timer number (0 to SYSTICK_NUM_TIMERS-1)
+ * @param ms: Timeout in milliseconds
+ */
+void systick_timer_start(unsigned char id, systick_t ms)
+{
+    systick_deadline_tab[id] = systick_deadline(ms);
+    systick_armed |= (1 << id);
+}
+
+/*
+ * Disarm software timer
+ *
+ * @param id: Timer number
+ */
+void systick_timer_stop(unsigned char id)
+{
+    systick_armed &= ~(1 << id);
+}
+
+/*
+ * Check if software timer is still counting
+ *
+ * @param id: Timer number
+ * @return: 1 if armed and not yet expired
+ */
+unsigned char systick_timer_running(unsigned char id)
+{
+    if (!(systick_armed & (1 << id))) return 0;
+    return !systick_expired(systick_deadline_tab[id]);
+}
+
+/*
+ * Poll software timer (one-shot)
+ * Returns 1 exactly once when the timeout passes, then disarms.
+ *
+ * @param id: Timer number
+ * @return: 1 on expiry, 0 otherwise
+ */
+unsigned char systick_timer_expired(unsigned char id)
+{
+    if (!(systick_armed & (1 << id))) return 0;
+    if (!systick_expired(systick_deadline_tab[id])) return 0;
+
+    systick_armed &= ~(1 << id);
+    return 1;
+}
+
+#endif /* SYSTICK_NUM_TIMERS */
+
+#endif /* SYSTICK_H */
@@ -0,0 +1,188 @@
+/*
+ * telemetry.h - Framed Binary Telemetry (COBS + CRC)
+ * 8051 Bootcamp Shared Library
+ *
+ * Usage:
+ *   1. Optional configuration before including:
+ *      #define TLM_PUTC(c)      uart_tx(c)  Byte output (default uart_tx)
+ *      #define TLM_MAX_PAYLOAD  32          Payload bytes per frame (<= 250)
+ *      #define TLM_CRC8                     CRC-8 instead of CRC-16
+ *      #include "../lib/uart.h"
+ *      #include "../lib/telemetry.h"
+ *
+ *   2. Send raw frames with tlm_send(), or batch samples:
+ *      tlm_batch_begin(TLM_BATCH8, 0);   channel 0, 8-bit samples
+ *      tlm_batch_add(adc_value);         sends itself when full
+ *
+ * Frame (before encoding):
+ *   [type][seq][payload ...][crc]       crc = CRC-16 (big endian) or CRC-8
+ *                                       over type, seq and payload
+ * On the wire the frame is COBS encoded and terminated by 0x00, so the
+ * receiver can resynchronise on any zero byte.
+ *
+ * Batch payloads:
+ *   TLM_BATCH8:  [channel][count][s0][s1]...        8-bit samples
+ *   TLM_BATCH16: [channel][count][s0 hi][s0 lo]...  16-bit big endian
+ *
+ * The host decoder is tools/tlm_decode.py.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef TLM_CRC8
+#define CRC_USE_CRC8
+#define CRC_NO_CRC16
+#endif
+#include "crc.h"
+
+#ifndef TLM_PUTC
+#define TLM_PUTC(c)         uart_tx(c)
+#endif
+
+#ifndef TLM_MAX_PAYLOAD
+#define TLM_MAX_PAYLOAD     32
+#endif
+
+#if TLM_MAX_PAYLOAD > 250
+#error "TLM_MAX_PAYLOAD must be 250 or less (frame <= 254 bytes, no COBS block split)"
+#endif
+
+/* Frame types */
+#define TLM_BATCH8          0x01
+#define TLM_BATCH16         0x02
+#define TLM_USER            0x40    /* First application-defined type */
+
+#ifdef TLM_CRC8
+#define TLM_CRC_LEN         1
+#else
+#define TLM_CRC_LEN         2
+#endif
+
+#define TLM_HDR_LEN         2
+#define TLM_FRAME_MAX       (TLM_HDR_LEN + TLM_MAX_PAYLOAD + TLM_CRC_LEN)
+
+unsigned char tlm_frame[TLM_FRAME_MAX];
+unsigned char tlm_seq;
+
+/* Batch in progress: tlm_frame[2] = channel, [3] = count */
+unsigned char tlm_batch_type;   /* TLM_BATCH8 or TLM_BATCH16 */
+unsigned char tlm_batch_len;    /* Payload bytes used, 0 = no batch */
+
+/*
+ * COBS encode tlm_frame[0..len-1] straight to TLM_PUTC
+ * Each block is a code byte (distance to the next zero) followed by
+ * the non-zero bytes. A frame is at most 254 bytes, so no block has to
+ * be split; a full-size frame with no zero is one 0xFF block, which is
+ * valid COBS (254 bytes, no zero implied) and ends the frame.
+ */
+static void _tlm_cobs_out(unsigned char len)
+{
+    unsigned char start = 0;
+    unsigned char end;
+
+    while (1) {
+        end = start;
+        while (end < len && tlm_frame[end] != 0) end++;
+
+        TLM_PUTC(end - start + 1);
+        while (start < end) TLM_PUTC(tlm_frame[start++]);
+
+        if (end >= len) break;
+        start = end + 1;    /* Skip the zero the code byte stood for */
+    }
+
+    TLM_PUTC(0x00);         /* Frame delimiter */
+}
+
+/* Fill header and CRC around tlm_frame[2..], then send */
+static void _tlm_finish(unsigned char type, unsigned char len)
+{
+    tlm_frame[0] = type;
+    tlm_frame[1] = tlm_seq++;
+    len += TLM_HDR_LEN;
+
+#ifdef TLM_CRC8
+    tlm_frame[len] = crc8(tlm_frame, len);
+#else
+    {
+        unsigned int crc = crc16(tlm_frame, len);
+        tlm_frame[len] = crc >> 8;
+        tlm_frame[len + 1] = crc & 0xFF;
+    }
+#endif
+
+    _tlm_cobs_out(len + TLM_CRC_LEN);
+}
+
+/*
+ * Send one frame
+ * Any batch in progress is discarded.
+ *
+ * @param type: Frame type (TLM_USER and up for application frames)
+ * @param payload: Payload bytes
+ * @param len: Payload length (<= TLM_MAX_PAYLOAD)
+ */
+void tlm_send(unsigned char type, unsigned char *payload, unsigned char len)
+{
+    unsigned char i;
+
+    if (len > TLM_MAX_PAYLOAD) len = TLM_MAX_PAYLOAD;
+    for (i = 0; i < len; i++)
+        tlm_frame[TLM_HDR_LEN + i] = payload[i];
+
+    tlm_batch_len = 0;
+    _tlm_finish(type, len);
+}
+
+/*
+ * Start a batch of samples
+ *
+ * @param type: TLM_BATCH8 or TLM_BATCH16
+ * @param channel: Channel number reported to the host
+ */
+void tlm_batch_begin(unsigned char type, unsigned char channel)
+{
+    tlm_batch_type = type;
+    tlm_frame[TLM_HDR_LEN] = channel;
+    tlm_frame[TLM_HDR_LEN + 1] = 0;
+    tlm_batch_len = 2;
+}
+
+/*
+ * Send the current batch (if it holds any samples) and start a new one
+ * on the same channel
+ */
+void tlm_batch_flush(void)
+{
+    if (tlm_batch_len > 2) {
+        _tlm_finish(tlm_batch_type, tlm_batch_len);
+        tlm_frame[TLM_HDR_LEN + 1] = 0;
+        tlm_batch_len = 2;
+    }
+}
+
+/*
+ * Add one sample to the batch, sending it when full
+ *
+ * @param sample: Value (low byte only for TLM_BATCH8)
+ */
+void tlm_batch_add(unsigned int sample)
+{
+    unsigned char i = TLM_HDR_LEN + tlm_batch_len;
+
+    if (tlm_batch_type == TLM_BATCH16) {
+        tlm_frame[i] = sample >> 8;
+        tlm_frame[i + 1] = sample & 0xFF;
+        tlm_batch_len += 2;
+    } else {
+        tlm_frame[i] = sample & 0xFF;
+        tlm_batch_len++;
+    }
+    tlm_frame[TLM_HDR_LEN + 1]++;
+
+    if (tlm_batch_len + (tlm_batch_type == TLM_BATCH16 ? 2 : 1) > TLM_MAX_PAYLOAD)
+        tlm_batch_flush();
+}
+
+#endif /* TELEMETRY_H */
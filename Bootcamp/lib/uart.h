@@ -4,46 +4,577 @@
  *
  * Usage: #include "../lib/uart.h"
  *
- * Default configuration: 9600 baud, 8N1
+ * Default configuration: 9600 baud, 8N1, Timer 1
  * Requires 11.0592MHz crystal for accurate baud rates
+ *
+ * Baud rate generation:
+ *   #define F_CPU          11059200UL  Crystal frequency (Hz)
+ *   #define UART_BAUD      115200UL    Rate used by uart_init()
+ *   #define UART_BAUD_GEN  2           1 = Timer 1 (default), 2 = Timer 2
+ *   #define UART_MAX_ERROR 20          Allowed rate error, per mille (2.0%)
+ *
+ *   Reload constants are computed from F_CPU at compile time and are
+ *   only defined when their error is within UART_MAX_ERROR, so an
+ *   unusable baud/crystal combination fails to build.
+ *     BAUD_xxxx       TH1 value, SMOD=0     uart_init_baud()
+ *     BAUD_SMOD_xxxx  TH1 value, SMOD=1     uart_init_smod()
+ *     T2_BAUD_xxxx    RCAP2 value           uart_init_t2() (UART_BAUD_GEN 2)
+ *   Timer 2 reaches 115200 at 11.0592MHz and leaves Timer 1 free.
+ *
+ * Interrupt-driven mode:
+ *   #define UART_BUFFERED before including to queue bytes in RX/TX
+ *   ring buffers serviced by the serial ISR (interrupt 4).
+ *   uart_tx(), uart_puts(), uart_putnum() and uart_puthex() then
+ *   return as soon as the bytes are queued.
+ *
+ *   #define UART_RX_SIZE   16        RX ring size (power of two, <= 256)
+ *   #define UART_TX_SIZE   16        TX ring size (power of two, <= 256)
+ *   #define UART_BUF_SPACE __idata   Buffer placement (__idata or __xdata)
+ *   #define UART_RX_HOOK(c) fn(c)    Hand each received byte to fn()
+ *                                    (called from the ISR) instead of
+ *                                    the RX ring; see shell.h
+ *
+ *   Flow control (buffered mode, pick one):
+ *   #define UART_FLOW_XONXOFF        Send XOFF/XON at the RX watermarks,
+ *                                    pause TX on XOFF from the host
+ *   #define UART_FLOW_RTSCTS         RTS (out, P3.4) high at the high
+ *                                    watermark; TX waits while CTS (in,
+ *                                    P3.3) is high. Both active low.
+ *   #define UART_RX_HIGH   12        Stop the sender at this fill level
+ *   #define UART_RX_LOW    4         Restart it at this level
+ *                                    (defaults: 3/4 and 1/4 of the ring)
+ *
+ *   uart_get_stats() reports dropped bytes, overrun events and the peak
+ *   RX fill level, to size the ring and watermarks for a baud rate.
  */
 
 #ifndef UART_H
 #define UART_H
 
 #include <8052.h>
+#include "numfmt.h"
 
-/* Baud rate settings for 11.0592MHz crystal */
-#define BAUD_9600   0xFD
-#define BAUD_4800   0xFA
-#define BAUD_2400   0xF4
-#define BAUD_1200   0xE8
+#ifndef F_CPU
+#define F_CPU   11059200UL
+#endif
+
+#ifndef UART_MAX_ERROR
+#define UART_MAX_ERROR  20      /* Per mille */
+#endif
+
+#ifndef UART_BAUD_GEN
+#define UART_BAUD_GEN   1
+#endif
 
 /*
- * Initialize UART
- * Timer 1 in Mode 2 (auto-reload)
- * Default: 9600 baud, 8N1
+ * Baud rate = F_CPU / (d * n)
+ *   Timer 1, SMOD=0: d = 384, n = 256 - TH1     (n <= 256)
+ *   Timer 1, SMOD=1: d = 192, n = 256 - TH1
+ *   Timer 2:         d = 32,  n = 65536 - RCAP2 (n <= 65536)
+ * n is rounded to nearest; _UART_ERR is the resulting error per mille.
  */
-void uart_init(void)
+#define _UART_N(d, b)       ((F_CPU + (d) * (b) / 2) / ((d) * (b)))
+#define _UART_RATE(d, b)    (_UART_N(d, b) ? F_CPU / ((d) * _UART_N(d, b)) : 0)
+#define _UART_ERR(d, b)     (_UART_RATE(d, b) > (b) \
+                             ? (_UART_RATE(d, b) - (b)) * 1000 / (b) \
+                             : ((b) - _UART_RATE(d, b)) * 1000 / (b))
+#define _UART_OK(d, b, max) (_UART_N(d, b) >= 1 && _UART_N(d, b) <= (max) \
+                             && _UART_ERR(d, b) <= UART_MAX_ERROR)
+
+#define _UART_TH1(d, b)     (256 - _UART_N(d, b))
+#define _UART_RCAP2(b)      (65536UL - _UART_N(32, b))
+
+/* Timer 1, SMOD=0 (uart_init_baud) */
+#if _UART_OK(384, 9600UL, 256)
+#define BAUD_9600   _UART_TH1(384, 9600UL)      /* 0xFD @ 11.0592MHz */
+#endif
+#if _UART_OK(384, 4800UL, 256)
+#define BAUD_4800   _UART_TH1(384, 4800UL)      /* 0xFA */
+#endif
+#if _UART_OK(384, 2400UL, 256)
+#define BAUD_2400   _UART_TH1(384, 2400UL)      /* 0xF4 */
+#endif
+#if _UART_OK(384, 1200UL, 256)
+#define BAUD_1200   _UART_TH1(384, 1200UL)      /* 0xE8 */
+#endif
+
+/* Timer 1, SMOD=1 (uart_init_smod) */
+#if _UART_OK(192, 19200UL, 256)
+#define BAUD_SMOD_19200 _UART_TH1(192, 19200UL) /* 0xFD */
+#endif
+#if _UART_OK(192, 57600UL, 256)
+#define BAUD_SMOD_57600 _UART_TH1(192, 57600UL) /* 0xFF */
+#endif
+
+/* Timer 2 (uart_init_t2) */
+#if _UART_OK(32, 9600UL, 65536UL)
+#define T2_BAUD_9600    _UART_RCAP2(9600UL)     /* 0xFFDC */
+#endif
+#if _UART_OK(32, 19200UL, 65536UL)
+#define T2_BAUD_19200   _UART_RCAP2(19200UL)    /* 0xFFEE */
+#endif
+#if _UART_OK(32, 38400UL, 65536UL)
+#define T2_BAUD_38400   _UART_RCAP2(38400UL)    /* 0xFFF7 */
+#endif
+#if _UART_OK(32, 57600UL, 65536UL)
+#define T2_BAUD_57600   _UART_RCAP2(57600UL)    /* 0xFFFA */
+#endif
+#if _UART_OK(32, 115200UL, 65536UL)
+#define T2_BAUD_115200  _UART_RCAP2(115200UL)   /* 0xFFFD */
+#endif
+
+/* Generator settings for uart_init() */
+#ifdef UART_BAUD
+#if UART_BAUD_GEN == 2
+#if !_UART_OK(32, UART_BAUD, 65536UL)
+#error "UART_BAUD not reachable within UART_MAX_ERROR using Timer 2"
+#endif
+#elif UART_BAUD_GEN == 1
+#if _UART_OK(384, UART_BAUD, 256)
+#define _UART_SMOD  0
+#define _UART_RELOAD _UART_TH1(384, UART_BAUD)
+#elif _UART_OK(192, UART_BAUD, 256)
+#define _UART_SMOD  1
+#define _UART_RELOAD _UART_TH1(192, UART_BAUD)
+#else
+#error "UART_BAUD not reachable within UART_MAX_ERROR using Timer 1 (try UART_BAUD_GEN 2)"
+#endif
+#else
+#error "UART_BAUD_GEN must be 1 or 2"
+#endif
+#endif /* UART_BAUD */
+
+#if UART_BAUD_GEN == 2 && defined(SYSTICK_H) && SYSTICK_TIMER == 2
+#error "Timer 2 is the systick timer: use SYSTICK_TIMER 0 or UART_BAUD_GEN 1"
+#endif
+
+#if UART_BAUD_GEN == 2 && defined(CAPTURE_H)
+#error "Timer 2 is used by capture.h: use UART_BAUD_GEN 1"
+#endif
+
+#if UART_BAUD_GEN == 1 && defined(SEG7_H) && defined(SEG7_ISR) && SEG7_TIMER == 1
+#error "Timer 1 multiplexes seg7.h: use SEG7_TIMER 0 or UART_BAUD_GEN 2"
+#endif
+
+#if UART_BAUD_GEN == 1 && defined(KEYPAD_H) && KEYPAD_TIMER == 1
+#error "Timer 1 scans keypad.h: use KEYPAD_TIMER 0 or UART_BAUD_GEN 2"
+#endif
+
+#if UART_BAUD_GEN == 1 && defined(BUTTON_H) && BUTTON_TIMER == 1
+#error "Timer 1 samples button.h: use BUTTON_TIMER 0 or UART_BAUD_GEN 2"
+#endif
+
+#ifdef UART_BUFFERED
+
+#ifndef UART_RX_SIZE
+#define UART_RX_SIZE    16
+#endif
+
+#ifndef UART_TX_SIZE
+#define UART_TX_SIZE    16
+#endif
+
+#ifndef UART_BUF_SPACE
+#define UART_BUF_SPACE  __idata
+#endif
+
+#if (UART_RX_SIZE & (UART_RX_SIZE - 1)) || UART_RX_SIZE > 256
+#error "UART_RX_SIZE must be a power of two <= 256"
+#endif
+
+#if (UART_TX_SIZE & (UART_TX_SIZE - 1)) || UART_TX_SIZE > 256
+#error "UART_TX_SIZE must be a power of two <= 256"
+#endif
+
+#define UART_RX_MASK    (UART_RX_SIZE - 1)
+#define UART_TX_MASK    (UART_TX_SIZE - 1)
+
+#if defined(UART_FLOW_XONXOFF) && defined(UART_FLOW_RTSCTS)
+#error "Define only one of UART_FLOW_XONXOFF and UART_FLOW_RTSCTS"
+#endif
+
+#if defined(UART_FLOW_XONXOFF) || defined(UART_FLOW_RTSCTS)
+#define _UART_FLOW
+#endif
+
+#ifdef _UART_FLOW
+
+#ifndef UART_RX_HIGH
+#define UART_RX_HIGH    (UART_RX_SIZE * 3 / 4)
+#endif
+
+#ifndef UART_RX_LOW
+#define UART_RX_LOW     (UART_RX_SIZE / 4)
+#endif
+
+#if UART_RX_HIGH > UART_RX_SIZE - 1 || UART_RX_LOW >= UART_RX_HIGH
+#error "Need UART_RX_LOW < UART_RX_HIGH <= UART_RX_SIZE - 1"
+#endif
+
+#endif /* _UART_FLOW */
+
+#ifdef UART_FLOW_XONXOFF
+#define UART_XON        0x11
+#define UART_XOFF       0x13
+#endif
+
+#ifdef UART_FLOW_RTSCTS
+#ifndef UART_RTS
+__sbit __at (0xB4) UART_RTS;  /* P3.4, output: 0 = send to us */
+#endif
+#ifndef UART_CTS
+__sbit __at (0xB3) UART_CTS;  /* P3.3, input: 0 = we may send */
+#endif
+#endif
+
+/*
+ * Ring buffers: head is written by the producer, tail by the consumer.
+ * Each index has a single writer and 8-bit stores are atomic, so
+ * neither side needs to disable interrupts.
+ */
+UART_BUF_SPACE volatile unsigned char uart_rx_buf[UART_RX_SIZE];
+UART_BUF_SPACE volatile unsigned char uart_tx_buf[UART_TX_SIZE];
+volatile unsigned char uart_rx_head;
+volatile unsigned char uart_rx_tail;
+volatile unsigned char uart_tx_head;
+volatile unsigned char uart_tx_tail;
+volatile __bit uart_tx_busy;
+
+/* Receive statistics (updated by the ISR, read with uart_get_stats) */
+typedef struct {
+    unsigned int rx_dropped;    /* Bytes lost, RX ring full */
+    unsigned int rx_overruns;   /* Times the ring overflowed */
+    unsigned int rx_stops;      /* Times the sender was told to stop */
+    unsigned char rx_peak;      /* Highest RX fill level seen */
+} uart_stats_t;
+
+uart_stats_t uart_stats;
+static __bit _uart_rx_full;     /* Currently dropping bytes */
+
+#ifdef _UART_FLOW
+volatile __bit uart_rx_stopped; /* Sender told to stop */
+#endif
+
+#ifdef UART_FLOW_XONXOFF
+volatile __bit uart_tx_paused;  /* XOFF received */
+volatile unsigned char _uart_flow_char;  /* XON/XOFF to send next, or 0 */
+#define _UART_TX_HELD   uart_tx_paused
+#elif defined(UART_FLOW_RTSCTS)
+#define _UART_TX_HELD   UART_CTS
+#else
+#define _UART_TX_HELD   0
+#endif
+
+/* Start the transmitter from the ISR when it is idle */
+#define _UART_KICK()    do { if (!uart_tx_busy) { uart_tx_busy = 1; TI = 1; } } while (0)
+
+#ifdef _UART_FLOW
+/* Tell the sender to stop (ISR context) */
+#ifdef UART_FLOW_RTSCTS
+#define _UART_RX_STOP() (UART_RTS = 1)
+#define _UART_RX_GO()   (UART_RTS = 0)
+#else
+#define _UART_RX_STOP() do { _uart_flow_char = UART_XOFF; _UART_KICK(); } while (0)
+#define _UART_RX_GO()   do { _uart_flow_char = UART_XON; _UART_KICK(); } while (0)
+#endif
+#endif
+
+/*
+ * Serial ISR
+ * RX: store byte, drop and count it if the ring is full (or pass it to
+ *     UART_RX_HOOK); stop the sender at UART_RX_HIGH with flow control
+ * TX: send a pending XON/XOFF first, then the next queued byte unless
+ *     the host has paused us; otherwise go idle
+ */
+void uart_isr(void) __interrupt(4)
 {
-    TMOD = (TMOD & 0x0F) | 0x20;  /* Timer 1, Mode 2 */
-    TH1 = BAUD_9600;              /* 9600 baud */
-    SCON = 0x50;                  /* Mode 1, REN enabled */
-    TR1 = 1;                      /* Start Timer 1 */
+    unsigned char c;
+#ifndef UART_RX_HOOK
+    unsigned char next;
+#endif
+
+    if (RI) {
+        RI = 0;
+        c = SBUF;
+
+#ifdef UART_FLOW_XONXOFF
+        if (c == UART_XOFF) {
+            uart_tx_paused = 1;
+        } else if (c == UART_XON) {
+            uart_tx_paused = 0;
+            _UART_KICK();           /* Handled by the TI branch below */
+        } else
+#endif
+        {
+#ifdef UART_RX_HOOK
+            UART_RX_HOOK(c);
+#else
+            next = (uart_rx_head + 1) & UART_RX_MASK;
+            if (next != uart_rx_tail) {
+                uart_rx_buf[uart_rx_head] = c;
+                uart_rx_head = next;
+                _uart_rx_full = 0;
+
+                c = (next - uart_rx_tail) & UART_RX_MASK;
+                if (c > uart_stats.rx_peak) uart_stats.rx_peak = c;
+#ifdef _UART_FLOW
+                if (c >= UART_RX_HIGH && !uart_rx_stopped) {
+                    uart_rx_stopped = 1;
+                    uart_stats.rx_stops++;
+                    _UART_RX_STOP();
+                }
+#endif
+            } else {
+                if (!_uart_rx_full) {
+                    _uart_rx_full = 1;
+                    uart_stats.rx_overruns++;
+#ifdef UART_FLOW_XONXOFF
+                    _UART_RX_STOP();    /* Our XOFF may have been lost */
+#endif
+                }
+                uart_stats.rx_dropped++;
+            }
+#endif /* UART_RX_HOOK */
+        }
+    }
+
+    if (TI) {
+        TI = 0;
+#ifdef UART_FLOW_XONXOFF
+        if (_uart_flow_char) {
+            SBUF = _uart_flow_char;
+            _uart_flow_char = 0;
+        } else
+#endif
+        if (uart_tx_head != uart_tx_tail && !_UART_TX_HELD) {
+            SBUF = uart_tx_buf[uart_tx_tail];
+            uart_tx_tail = (uart_tx_tail + 1) & UART_TX_MASK;
+        } else {
+            uart_tx_busy = 0;
+        }
+    }
 }
 
+static void _uart_buf_init(void)
+{
+    uart_rx_head = uart_rx_tail = 0;
+    uart_tx_head = uart_tx_tail = 0;
+    uart_tx_busy = 0;
+#ifdef UART_FLOW_XONXOFF
+    uart_tx_paused = 0;
+    _uart_flow_char = 0;
+#endif
+#ifdef _UART_FLOW
+    uart_rx_stopped = 0;
+#endif
+#ifdef UART_FLOW_RTSCTS
+    UART_CTS = 1;       /* Input */
+    UART_RTS = 0;       /* Ready to receive */
+#endif
+    ES = 1;     /* Enable serial interrupt */
+    EA = 1;     /* Global interrupt enable */
+}
+
+#endif /* UART_BUFFERED */
+
 /*
  * Initialize UART with specific baud rate
+ * Timer 1 in Mode 2 (auto-reload), SMOD=0
  *
  * @param baud_val: TH1 value (use BAUD_xxxx defines)
  */
 void uart_init_baud(unsigned char baud_val)
 {
-    TMOD = (TMOD & 0x0F) | 0x20;
+    PCON &= 0x7F;                 /* SMOD = 0 */
+    TMOD = (TMOD & 0x0F) | 0x20;  /* Timer 1, Mode 2 */
     TH1 = baud_val;
-    SCON = 0x50;
-    TR1 = 1;
+    SCON = 0x50;                  /* Mode 1, REN enabled */
+    TR1 = 1;                      /* Start Timer 1 */
+#ifdef UART_BUFFERED
+    _uart_buf_init();
+#endif
+}
+
+/*
+ * Initialize UART with doubled baud rate
+ * Timer 1 in Mode 2 (auto-reload), SMOD=1
+ *
+ * @param baud_val: TH1 value (use BAUD_SMOD_xxxx defines)
+ */
+void uart_init_smod(unsigned char baud_val)
+{
+    uart_init_baud(baud_val);
+    PCON |= 0x80;                 /* SMOD = 1 */
+}
+
+#if UART_BAUD_GEN == 2
+/*
+ * Initialize UART with Timer 2 as baud generator (8052)
+ * Timer 2 in baud rate mode (RCLK = TCLK = 1), Timer 1 stays free.
+ * Only built with UART_BAUD_GEN 2, so the Timer 2 checks above apply.
+ *
+ * @param rcap: RCAP2 reload value (use T2_BAUD_xxxx defines)
+ */
+void uart_init_t2(unsigned int rcap)
+{
+    T2CON = 0x30;                 /* RCLK = TCLK = 1, stopped */
+    RCAP2H = rcap >> 8;
+    RCAP2L = rcap & 0xFF;
+    TH2 = RCAP2H;
+    TL2 = RCAP2L;
+    SCON = 0x50;                  /* Mode 1, REN enabled */
+    TR2 = 1;                      /* Start Timer 2 */
+#ifdef UART_BUFFERED
+    _uart_buf_init();
+#endif
 }
+#endif /* UART_BAUD_GEN == 2 */
+
+/*
+ * Initialize UART
+ * Default: 9600 baud, 8N1 on Timer 1
+ * With UART_BAUD defined: that rate on the UART_BAUD_GEN timer
+ */
+void uart_init(void)
+{
+#if !defined(UART_BAUD)
+    uart_init_baud(BAUD_9600);
+#elif UART_BAUD_GEN == 2
+    uart_init_t2(_UART_RCAP2(UART_BAUD));
+#elif _UART_SMOD
+    uart_init_smod(_UART_RELOAD);
+#else
+    uart_init_baud(_UART_RELOAD);
+#endif
+}
+
+#ifdef UART_BUFFERED
+
+/*
+ * Restart transmission if it is idle with bytes queued
+ * Needed with UART_FLOW_RTSCTS only, when CTS returns low and no
+ * uart_tx()/uart_flush() call follows; XON restarts by itself.
+ * The test and the kick are done with the serial interrupt off: the ISR
+ * may start sending an XON/XOFF in between, and a second kick would then
+ * write SBUF while that byte is still going out.
+ */
+void uart_tx_resume(void)
+{
+    ES = 0;
+    if (!uart_tx_busy && uart_tx_head != uart_tx_tail && !_UART_TX_HELD) {
+        uart_tx_busy = 1;
+        TI = 1;
+    }
+    ES = 1;
+}
+
+/*
+ * Queue single character for transmission
+ * Blocks only while the TX ring is full
+ *
+ * @param c: Character to transmit
+ */
+void uart_tx(unsigned char c)
+{
+    unsigned char next = (uart_tx_head + 1) & UART_TX_MASK;
+
+    while (next == uart_tx_tail)
+        uart_tx_resume();
+    uart_tx_buf[uart_tx_head] = c;
+    uart_tx_head = next;
+
+    uart_tx_resume();
+}
+
+/*
+ * Receive single character (blocking)
+ *
+ * @return: Received character
+ */
+unsigned char uart_rx(void)
+{
+    unsigned char c;
+
+    while (uart_rx_head == uart_rx_tail);
+    c = uart_rx_buf[uart_rx_tail];
+    uart_rx_tail = (uart_rx_tail + 1) & UART_RX_MASK;
+
+#ifdef _UART_FLOW
+    /* Let the sender go again once drained to the low watermark */
+    if (uart_rx_stopped) {
+        ES = 0;
+        if (((uart_rx_head - uart_rx_tail) & UART_RX_MASK) <= UART_RX_LOW) {
+            uart_rx_stopped = 0;
+            _UART_RX_GO();
+        }
+        ES = 1;
+    }
+#endif
+
+    return c;
+}
+
+/*
+ * Check if data available
+ *
+ * @return: Number of bytes waiting in the RX ring
+ */
+unsigned char uart_available(void)
+{
+    return (uart_rx_head - uart_rx_tail) & UART_RX_MASK;
+}
+
+/*
+ * Receive character (non-blocking)
+ *
+ * @return: Received character, or 0 if none available
+ */
+unsigned char uart_rx_nb(void)
+{
+    if (uart_rx_head == uart_rx_tail) return 0;
+    return uart_rx();
+}
+
+/*
+ * Wait until every queued byte has been sent
+ * (also waits out an XOFF or CTS pause)
+ */
+void uart_flush(void)
+{
+    while (uart_tx_busy || uart_tx_head != uart_tx_tail)
+        uart_tx_resume();
+}
+
+/*
+ * Read receive statistics
+ * Copied with the serial interrupt masked, so the fields agree.
+ *
+ * @param st: Receives the counters
+ */
+void uart_get_stats(uart_stats_t *st)
+{
+    ES = 0;
+    st->rx_dropped = uart_stats.rx_dropped;
+    st->rx_overruns = uart_stats.rx_overruns;
+    st->rx_stops = uart_stats.rx_stops;
+    st->rx_peak = uart_stats.rx_peak;
+    ES = 1;
+}
+
+/*
+ * Reset receive statistics
+ */
+void uart_clear_stats(void)
+{
+    ES = 0;
+    uart_stats.rx_dropped = 0;
+    uart_stats.rx_overruns = 0;
+    uart_stats.rx_stops = 0;
+    uart_stats.rx_peak = 0;
+    ES = 1;
+}
+
+#else
 
 /*
  * Transmit single character
@@ -91,6 +622,16 @@ unsigned char uart_rx_nb(void)
     return SBUF;
 }
 
+/*
+ * Wait until transmission is complete
+ * (uart_tx() is synchronous in polled mode)
+ */
+void uart_flush(void)
+{
+}
+
+#endif /* UART_BUFFERED */
+
 /*
  * Transmit string
  *
@@ -110,15 +651,17 @@ void uart_puts(char *str)
  */
 void uart_putnum(unsigned char num)
 {
-    unsigned char hundreds, tens, ones;
-
-    hundreds = num / 100;
-    tens = (num / 10) % 10;
-    ones = num % 10;
+    uart_puts(numfmt_u8(num, 0, ' '));
+}
 
-    if (hundreds > 0) uart_tx('0' + hundreds);
-    if (hundreds > 0 || tens > 0) uart_tx('0' + tens);
-    uart_tx('0' + ones);
+/*
+ * Transmit unsigned int as decimal
+ *
+ * @param num: Number to transmit (0-65535)
+ */
+void uart_putint(unsigned int num)
+{
+    uart_puts(numfmt_u16(num, 0, ' '));
 }
 
 /*
@@ -128,15 +671,8 @@ void uart_putnum(unsigned char num)
  */
 void uart_puthex(unsigned char num)
 {
-    unsigned char nibble;
-
     uart_puts("0x");
-
-    nibble = (num >> 4) & 0x0F;
-    uart_tx(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
-
-    nibble = num & 0x0F;
-    uart_tx(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
+    uart_puts(numfmt_hex8(num, 2, '0'));
 }
 
 /*
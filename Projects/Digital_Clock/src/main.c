@@ -6,72 +6,142 @@
  *   - 4-digit 7-segment (CC) on P1 (segments), P2.0-3 (digits)
  *   - Buttons: P3.2 (Mode), P3.3 (Up), P3.4 (Down)
  *   - Crystal: 11.0592MHz for accurate timing
+ *
+ * Timer 2: clock tick. Timer 1: display multiplexing (lib/seg7.h).
+ * Timer 0: button sampling (lib/button.h), so the main loop never waits
+ * on a button. UP/DOWN in normal mode dim or brighten the display; held
+ * in the set modes, they auto-repeat.
+ *
+ * Timer 2 reloads itself in hardware, so the 50ms tick is exact to the
+ * crystal no matter how late the ISR runs. The crystal's own error is
+ * trimmed in ppm (CLOCK_TRIM_PPM, or the fourth MODE setting): the ISR
+ * stretches or shortens single periods by one machine cycle as a
+ * fractional accumulator overflows. 1ppm = 86ms per day.
+ *
+ * Time is kept in packed BCD (0x23 = 23): the ISR steps it with a
+ * decimal-adjust carry, so the digits are just the two nibbles - no
+ * division or number formatting - and the display buffer is only
+ * rewritten when a shown digit or the colon changes.
+ *
+ * Benchmark (main loop passes per second, shown / 10 on the display):
+ *   sdcc -mmcs51 -DBENCH_LOOP ...                  BCD, redraw on change
+ *   sdcc -mmcs51 -DBENCH_LOOP -DBENCH_OLD_PATH ... binary + numfmt,
+ *                                                  redraw every pass
+ * make -C tests/sim clock runs both in s51 and prints the full counts.
  */
 
 #include <8052.h>
 
-/* Pin Definitions */
-#define SEGMENTS P1
-#define DIGITS   P2
-
-__sbit __at (0xB2) BTN_MODE;   /* P3.2 */
-__sbit __at (0xB3) BTN_UP;     /* P3.3 */
-__sbit __at (0xB4) BTN_DOWN;   /* P3.4 */
-
-/* 7-Segment patterns (Common Cathode) */
-__code unsigned char SEG_PATTERN[] = {
-    0x3F,  /* 0 */
-    0x06,  /* 1 */
-    0x5B,  /* 2 */
-    0x4F,  /* 3 */
-    0x66,  /* 4 */
-    0x6D,  /* 5 */
-    0x7D,  /* 6 */
-    0x07,  /* 7 */
-    0x7F,  /* 8 */
-    0x6F   /* 9 */
-};
-
-/* Digit select patterns (active low) */
-__code unsigned char DIGIT_SEL[] = {
-    0xFE,  /* Digit 0 */
-    0xFD,  /* Digit 1 */
-    0xFB,  /* Digit 2 */
-    0xF7   /* Digit 3 */
-};
+/* Buttons: P3.2 (Mode), P3.3 (Up), P3.4 (Down), sampled by Timer 0 */
+#define BTN_MODE    0x04
+#define BTN_UP      0x08
+#define BTN_DOWN    0x10
+#define BUTTON_MASK         (BTN_MODE | BTN_UP | BTN_DOWN)
+#define BUTTON_REPEAT_MASK  (BTN_UP | BTN_DOWN)
+#include "../../../Bootcamp/lib/button.h"
+
+/* Display: segments P1, digits P2.0-P2.3 (lib/seg7.h defaults) */
+#define DISPLAY_SEG7
+#define SEG7_ISR
+#define SEG7_TIMER  1
+#include "../../../Bootcamp/lib/display.h"
 
 /* Operating modes */
 #define MODE_NORMAL     0
 #define MODE_SET_HOUR   1
 #define MODE_SET_MIN    2
+#define MODE_SET_TRIM   3
+
+/*
+ * Clock tick: Timer 2 auto-reload, 20 per second
+ * 11.0592MHz: 46080 cycles (reload 0x4C00). 12MHz: 50000.
+ */
+#define TICKS_PER_SEC   20
+#define TICK_CYCLES     (F_CPU / 12UL / TICKS_PER_SEC)
+
+#if TICK_CYCLES > 65535UL
+#error "F_CPU too high for a 50ms Timer 2 tick"
+#endif
 
-/* Time variables (volatile - modified in ISR) */
-volatile unsigned char hours = 12;
-volatile unsigned char minutes = 0;
-volatile unsigned char seconds = 0;
+#if (F_CPU / 12UL) % TICKS_PER_SEC != 0
+#error "F_CPU / 12 must be a multiple of 20 for an exact tick"
+#endif
+
+/*
+ * Crystal trim in ppm: + if the clock gains time, - if it loses
+ * (seconds gained per day / 0.0864). Adjustable at run time.
+ */
+#ifndef CLOCK_TRIM_PPM
+#define CLOCK_TRIM_PPM  0
+#endif
+#define TRIM_MAX        500
+
+#if CLOCK_TRIM_PPM > TRIM_MAX || CLOCK_TRIM_PPM < -TRIM_MAX
+#error "CLOCK_TRIM_PPM out of range (-500 to 500)"
+#endif
+
+/* Time variables, packed BCD (volatile - modified in ISR) */
+volatile unsigned char hours = 0x12;
+volatile unsigned char minutes = 0x00;
+volatile unsigned char seconds = 0x00;
 volatile unsigned char tick_count = 0;
 volatile unsigned char second_flag = 0;
+volatile __bit redraw = 1;      /* Shown digits or colon changed */
+
+/* Packed BCD increment: carry into the tens nibble like DA A */
+#define BCD_INC(v)  do { (v)++; if (((v) & 0x0F) == 0x0A) (v) += 6; } while (0)
+
+/* Packed BCD to binary (benchmark baseline only) */
+#define BCD_BIN(v)  (((v) >> 4) * 10 + ((v) & 0x0F))
+
+#ifdef BENCH_LOOP
+/* Once a second with the passes counted (tests/sim/clock_bench.c) */
+#ifndef BENCH_REPORT
+#define BENCH_REPORT(n)     do { \
+        disp_goto(0, 0); disp_num((n) / 10, 4, ' '); disp_flush(); \
+    } while (0)
+#endif
+#endif
 
 /* Display variables */
-unsigned char display[4] = {1, 2, 0, 0};
 unsigned char current_mode = MODE_NORMAL;
+unsigned char brightness = SEG7_LEVELS;
 unsigned char blink_state = 0;
 unsigned char blink_counter = 0;
 
-/* Button state */
-unsigned char mode_prev = 1;
-unsigned char up_prev = 1;
-unsigned char down_prev = 1;
+/*
+ * Trim state. Per tick the period changes by trim_cycles plus
+ * trim_frac millionths of a cycle; trim_acc collects the millionths.
+ */
+signed int trim_ppm = CLOCK_TRIM_PPM;
+unsigned char trim_cycles;
+unsigned long trim_frac;
+unsigned long trim_acc;
+__bit trim_longer;              /* 1 = lengthen periods (clock gains) */
 
 /*
- * Timer 0 ISR - 50ms interrupt
- * 20 interrupts = 1 second
+ * Timer 2 ISR - 50ms interrupt
+ * 20 interrupts = 1 second. Writing RCAP2 sets the *next* period.
  */
-void timer0_isr(void) __interrupt(1)
+void timer2_isr(void) __interrupt(5)
 {
-    /* Reload timer for 50ms @ 11.0592MHz */
-    TH0 = 0x4C;
-    TL0 = 0x00;
+    unsigned char extra = trim_cycles;
+    unsigned int reload;
+
+    TF2 = 0;    /* Not cleared by hardware */
+
+    trim_acc += trim_frac;
+    if (trim_acc >= 1000000UL) {
+        trim_acc -= 1000000UL;
+        extra++;
+    }
+    if (trim_longer) {
+        reload = (unsigned int)(65536UL - TICK_CYCLES) - extra;
+    } else {
+        reload = (unsigned int)(65536UL - TICK_CYCLES) + extra;
+    }
+    RCAP2H = reload >> 8;
+    RCAP2L = reload & 0xFF;
 
     tick_count++;
     if (tick_count >= 20) {
@@ -79,17 +149,18 @@ void timer0_isr(void) __interrupt(1)
         second_flag = 1;
 
         /* Increment time */
-        seconds++;
-        if (seconds >= 60) {
+        BCD_INC(seconds);
+        if (seconds == 0x60) {
             seconds = 0;
-            minutes++;
-            if (minutes >= 60) {
+            BCD_INC(minutes);
+            if (minutes == 0x60) {
                 minutes = 0;
-                hours++;
-                if (hours >= 24) {
+                BCD_INC(hours);
+                if (hours == 0x24) {
                     hours = 0;
                 }
             }
+            redraw = 1;
         }
     }
 
@@ -98,147 +169,203 @@ void timer0_isr(void) __interrupt(1)
     if (blink_counter >= 5) {
         blink_counter = 0;
         blink_state = !blink_state;
+        redraw = 1;             /* Colon */
     }
 }
 
-void timer_init(void)
+/*
+ * Split trim_ppm into whole and millionth cycles per tick
+ * (done here, so the ISR only adds and compares)
+ */
+void trim_apply(void)
 {
-    TMOD = (TMOD & 0xF0) | 0x01;  /* Timer 0, Mode 1 */
-    TH0 = 0x4C;
-    TL0 = 0x00;
-    ET0 = 1;    /* Enable Timer 0 interrupt */
-    EA = 1;     /* Global interrupt enable */
-    TR0 = 1;    /* Start Timer 0 */
-}
+    unsigned long e;
 
-void delay_us(unsigned int us)
-{
-    while (us--);
+    if (trim_ppm < 0) {
+        e = (unsigned long)(-trim_ppm) * TICK_CYCLES;
+    } else {
+        e = (unsigned long)trim_ppm * TICK_CYCLES;
+    }
+
+    ET2 = 0;
+    trim_longer = (trim_ppm > 0);
+    trim_cycles = e / 1000000UL;
+    trim_frac = e % 1000000UL;
+    ET2 = 1;
 }
 
-void delay_ms(unsigned int ms)
+void timer_init(void)
 {
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 100; j++);
+    T2CON = 0x00;       /* Auto-reload, timer mode, stopped */
+    RCAP2H = (unsigned int)(65536UL - TICK_CYCLES) >> 8;
+    RCAP2L = (unsigned int)(65536UL - TICK_CYCLES) & 0xFF;
+    TH2 = RCAP2H;
+    TL2 = RCAP2L;
+    trim_acc = 0;
+    trim_apply();       /* Enables Timer 2 interrupt */
+    EA = 1;             /* Global interrupt enable */
+    TR2 = 1;            /* Start Timer 2 */
 }
 
-/* Update display buffer from time */
+/* Update display buffer from time (the Timer 1 ISR shows it) */
 void update_display(void)
 {
-    display[0] = hours / 10;
-    display[1] = hours % 10;
-    display[2] = minutes / 10;
-    display[3] = minutes % 10;
+    unsigned char h = hours;
+    unsigned char m = minutes;
+
+    disp_goto(0, 0);
+
+    /* Trim: signed ppm, all digits flash */
+    if (current_mode == MODE_SET_TRIM) {
+        disp_puts(numfmt_s16(trim_ppm, 4, ' '));
+#ifndef BENCH_LOOP
+        disp_flush();
+#endif
+        seg7_blink = 0x0F;
+        return;
+    }
+#ifdef BENCH_OLD_PATH
+    disp_num(BCD_BIN(h), 2, '0');
+#else
+    disp_putc('0' + (h >> 4));
+    disp_putc('0' + (h & 0x0F));
+#endif
+
+    /* Colon: decimal point on digit 1 */
+    if (current_mode == MODE_NORMAL && blink_state) {
+        disp_putc('.');
+    }
+
+#ifdef BENCH_OLD_PATH
+    disp_num(BCD_BIN(m), 2, '0');
+#else
+    disp_putc('0' + (m >> 4));
+    disp_putc('0' + (m & 0x0F));
+#endif
+#ifndef BENCH_LOOP
+    disp_flush();
+#endif
+
+    /* Digits being set flash */
+    if (current_mode == MODE_SET_HOUR) {
+        seg7_blink = 0x03;
+    } else if (current_mode == MODE_SET_MIN) {
+        seg7_blink = 0x0C;
+    } else {
+        seg7_blink = 0x00;
+    }
 }
 
-/* Refresh display (call frequently) */
-void refresh_display(void)
+/* Set all digits to the current brightness */
+void set_brightness(void)
 {
     unsigned char i;
-    unsigned char pattern;
-    unsigned char show_digit;
-
-    for (i = 0; i < 4; i++) {
-        DIGITS = 0xFF;  /* All digits off */
-
-        /* Determine if digit should be shown (for blinking) */
-        show_digit = 1;
-        if (current_mode == MODE_SET_HOUR && (i == 0 || i == 1)) {
-            show_digit = blink_state;
-        }
-        if (current_mode == MODE_SET_MIN && (i == 2 || i == 3)) {
-            show_digit = blink_state;
-        }
-
-        if (show_digit) {
-            pattern = SEG_PATTERN[display[i]];
-
-            /* Add colon (decimal point on digit 1) */
-            if (i == 1 && current_mode == MODE_NORMAL) {
-                if (blink_state) {
-                    pattern |= 0x80;  /* DP on */
-                }
-            }
-
-            SEGMENTS = pattern;
-        } else {
-            SEGMENTS = 0x00;  /* Blank */
-        }
 
-        DIGITS = DIGIT_SEL[i];
-        delay_us(500);
+    for (i = 0; i < SEG7_NUM_DIGITS; i++) {
+        seg7_bright(i, brightness);
     }
-
-    DIGITS = 0xFF;  /* All off */
 }
 
-/* Check button press (with debounce) */
-unsigned char button_pressed(unsigned char *prev, unsigned char current)
+/*
+ * Step a packed BCD value, wrapping within 0..max
+ *
+ * @param v: Current value (BCD)
+ * @param max: Largest value (BCD), e.g. 0x23 for hours
+ * @return: v + 1 or v - 1 (BCD)
+ */
+unsigned char bcd_up(unsigned char v, unsigned char max)
 {
-    unsigned char pressed = 0;
-
-    if (current == 0 && *prev == 1) {
-        delay_ms(20);  /* Debounce */
-        if (current == 0) {
-            pressed = 1;
-        }
-    }
-    *prev = current;
+    if (v >= max) return 0;
+    BCD_INC(v);
+    return v;
+}
 
-    return pressed;
+unsigned char bcd_down(unsigned char v, unsigned char max)
+{
+    if (v == 0) return max;
+    if ((v & 0x0F) == 0) return v - 7;     /* 0x10 -> 0x09 */
+    return v - 1;
 }
 
 /* Handle mode button */
 void handle_mode(void)
 {
-    if (button_pressed(&mode_prev, BTN_MODE)) {
+    if (button_pressed(BTN_MODE)) {
         current_mode++;
-        if (current_mode > MODE_SET_MIN) {
+        if (current_mode > MODE_SET_TRIM) {
             current_mode = MODE_NORMAL;
         }
+        redraw = 1;
     }
 }
 
-/* Handle up/down buttons */
+/* Handle up/down buttons (press, then repeat while held) */
 void handle_adjust(void)
 {
-    if (current_mode == MODE_SET_HOUR) {
-        if (button_pressed(&up_prev, BTN_UP)) {
-            hours++;
-            if (hours >= 24) hours = 0;
+    unsigned char b = button_repeat(BTN_UP | BTN_DOWN);
+
+    if (current_mode == MODE_NORMAL) {
+        if ((b & BTN_UP) && brightness < SEG7_LEVELS) {
+            brightness++;
+            set_brightness();
+        }
+        if ((b & BTN_DOWN) && brightness > 1) {
+            brightness--;
+            set_brightness();
+        }
+    }
+    else if (current_mode == MODE_SET_HOUR) {
+        if (b & BTN_UP) {
+            hours = bcd_up(hours, 0x23);
+            redraw = 1;
         }
-        if (button_pressed(&down_prev, BTN_DOWN)) {
-            if (hours == 0) hours = 23;
-            else hours--;
+        if (b & BTN_DOWN) {
+            hours = bcd_down(hours, 0x23);
+            redraw = 1;
         }
     }
     else if (current_mode == MODE_SET_MIN) {
-        if (button_pressed(&up_prev, BTN_UP)) {
-            minutes++;
-            if (minutes >= 60) minutes = 0;
+        if (b & BTN_UP) {
+            minutes = bcd_up(minutes, 0x59);
             seconds = 0;  /* Reset seconds when setting */
+            redraw = 1;
         }
-        if (button_pressed(&down_prev, BTN_DOWN)) {
-            if (minutes == 0) minutes = 59;
-            else minutes--;
+        if (b & BTN_DOWN) {
+            minutes = bcd_down(minutes, 0x59);
             seconds = 0;
+            redraw = 1;
+        }
+    }
+    else if (current_mode == MODE_SET_TRIM) {
+        if ((b & BTN_UP) && trim_ppm < TRIM_MAX) {
+            trim_ppm++;
+            trim_apply();
+            redraw = 1;
+        }
+        if ((b & BTN_DOWN) && trim_ppm > -TRIM_MAX) {
+            trim_ppm--;
+            trim_apply();
+            redraw = 1;
         }
     }
 }
 
 void main(void)
 {
+#ifdef BENCH_LOOP
+    unsigned int passes = 0;
+#endif
+
     /* Initialize */
-    SEGMENTS = 0x00;
-    DIGITS = 0xFF;
+    disp_init();                /* Starts multiplexing on Timer 1 */
+    button_init();
 
     timer_init();
 
     /* Initial time: 12:00 */
-    hours = 12;
-    minutes = 0;
-    seconds = 0;
+    hours = 0x12;
+    minutes = 0x00;
+    seconds = 0x00;
 
     while (1) {
         /* Handle buttons */
@@ -246,9 +373,22 @@ void main(void)
         handle_adjust();
 
         /* Update display buffer */
+#ifdef BENCH_OLD_PATH
         update_display();
-
-        /* Refresh display */
-        refresh_display();
+#else
+        if (redraw) {
+            redraw = 0;
+            update_display();
+        }
+#endif
+
+#ifdef BENCH_LOOP
+        passes++;
+        if (second_flag) {
+            second_flag = 0;
+            BENCH_REPORT(passes);
+            passes = 0;
+        }
+#endif
     }
 }
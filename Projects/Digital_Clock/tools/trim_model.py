@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+trim_model.py - Cycle-exact model of the Digital_Clock tick and trim
+
+Replays what timer2_isr() and trim_apply() in src/main.c do, tick by
+tick, in whole machine cycles: Timer 2 reloads from RCAP2 at each
+overflow, and the ISR's RCAP2 write sets the period after the next one.
+Prints the README's residual error table:
+
+    python3 tools/trim_model.py                 (from Projects/Digital_Clock)
+    python3 tools/trim_model.py --days 1 --crystal 20.4 --trim 20
+
+--s51 runs tests/sim/clock_drift.c in the s51 simulator for trims 0,
++20 and -35 and checks the simulated clock counts against the model
+(needs sdcc and s51, see tests/sim/README.md):
+
+    python3 tools/trim_model.py --s51 60
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+F_CPU = 11059200
+TICKS_PER_SEC = 20
+TICK_CYCLES = F_CPU // 12 // TICKS_PER_SEC      # 46080
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SIM = os.path.normpath(os.path.join(HERE, "..", "..", "..", "tests", "sim"))
+
+# README table: (crystal error ppm, trim ppm)
+CASES = [(20, 0), (20, 20), (-35, -35), (20.4, 20)]
+
+
+def trim_apply(ppm):
+    """trim_longer, trim_cycles, trim_frac as trim_apply() sets them"""
+    e = abs(ppm) * TICK_CYCLES
+    return ppm > 0, e // 1000000, e % 1000000
+
+
+def cycles(ticks, ppm):
+    """Machine cycles from Timer 2 start to the end of tick `ticks`"""
+    longer, whole, frac = trim_apply(ppm)
+    rcap = TICK_CYCLES          # Period loaded by timer_init()
+    total = TICK_CYCLES         # Tick 1 runs from TH2/TL2 = RCAP2
+    acc = 0
+    for _ in range(ticks - 1):
+        # ISR at the end of the tick just counted: next RCAP2
+        extra = whole
+        acc += frac
+        if acc >= 1000000:
+            acc -= 1000000
+            extra += 1
+        nxt = TICK_CYCLES + extra if longer else TICK_CYCLES - extra
+        total += rcap           # This overflow reloaded the old RCAP2
+        rcap = nxt
+    return total
+
+
+def error_s(seconds, crystal_ppm, trim):
+    """Clock reading minus real time after `seconds` shown"""
+    real = cycles(seconds * TICKS_PER_SEC, trim) * 12.0 / (F_CPU * (1 + crystal_ppm / 1e6))
+    return seconds - real
+
+
+def table(days, cases):
+    secs = int(days * 86400)
+    print("| Crystal error | Trim | Error after %g days |" % days)
+    print("|---------------|------|--------------------|")
+    for crystal, trim in cases:
+        err = round(error_s(secs, crystal, trim), 2)
+        print("| %+gppm | %s | %s |" % (crystal, "%+d" % trim if trim else "0",
+                                        "%+.2fs" % err if err else "0.00s"))
+
+
+def s51(seconds):
+    """Run clock_drift.c in s51 and compare the clock counts"""
+    runner = os.path.join(SIM, "s51_run.py")
+    src = os.path.join(SIM, "clock_drift.c")
+    got = {}
+    for trim in (0, 20, -35):
+        out = subprocess.run([sys.executable, runner, "--clocks",
+                              "-DSIM_SECONDS=%d" % seconds,
+                              "-DCLOCK_TRIM_PPM=%d" % trim, src],
+                             capture_output=True, text=True)
+        sys.stdout.write(out.stdout)
+        m = re.search(r"clocks (\d+)", out.stdout)
+        if out.returncode or not m:
+            sys.stderr.write(out.stderr)
+            sys.exit("clock_drift.c failed for trim %d" % trim)
+        got[trim] = int(m.group(1))
+
+    # Start-up (reset to TR2 = 1) is the same code in every build: take
+    # it from the untrimmed run, then every trim must match the model.
+    ticks = seconds * TICKS_PER_SEC
+    start = got[0] - 12 * cycles(ticks, 0)
+    print("start-up: %d clocks" % start)
+    bad = not 0 <= start < 12 * 20000
+    for trim, clocks in sorted(got.items()):
+        model = 12 * cycles(ticks, trim) + start
+        diff = (clocks - model) // 12
+        ok = abs(diff) <= 200
+        bad |= not ok
+        print("trim %+4d ppm: s51 %d, model %d clocks (%+d cycles) %s"
+              % (trim, clocks, model, diff, "ok" if ok else "FAIL"))
+    sys.exit(1 if bad else 0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    ap.add_argument("--days", type=float, default=3)
+    ap.add_argument("--crystal", type=float, help="crystal error, ppm")
+    ap.add_argument("--trim", type=int, default=0, help="CLOCK_TRIM_PPM")
+    ap.add_argument("--s51", type=int, metavar="SECONDS",
+                    help="check the model against s51 over SECONDS")
+    args = ap.parse_args()
+
+    if args.s51:
+        s51(args.s51)
+    elif args.crystal is not None:
+        table(args.days, [(args.crystal, args.trim)])
+    else:
+        table(args.days, CASES)
+
+
+if __name__ == "__main__":
+    main()
@@ -11,15 +11,26 @@
 
 #include <8052.h>
 
-/* ========== Pin Definitions ========== */
+/* ========== Libraries ========== */
+
+#define F_CPU           12000000UL
+#define SCHED_NUM_TASKS 3
+#include "../../../Bootcamp/lib/lcd.h"      /* P2.0=RS, P2.1=EN, P2.4-7=D4-D7 */
+#include "../../../Bootcamp/lib/sched.h"
 
-/* Keypad on P1 */
-#define KEYPAD_PORT P1
+/* Tasks (index into sched_tasks, also priority order) */
+#define TASK_UI         0
+#define TASK_SECOND     1
+#define TASK_BUZZER     2
 
-/* LCD on P2 */
-__sbit __at (0xA0) LCD_RS;
-__sbit __at (0xA1) LCD_EN;
-#define LCD_DATA P2
+/* Keypad on P1, scanned by the Timer 1 ISR; each event wakes the UI task */
+#define KEYPAD_PORT     P1
+#define KEYPAD_TIMER    1
+#define KEYPAD_REPEAT_MS 0
+#define KEYPAD_EVENT_HOOK() sched_signal(TASK_UI)
+#include "../../../Bootcamp/lib/keypad.h"
+
+/* ========== Pin Definitions ========== */
 
 /* Outputs on P3 */
 __sbit __at (0xB0) RELAY;
@@ -33,185 +44,50 @@ __sbit __at (0xB3) LED_RED;
 #define MAX_ATTEMPTS    3
 #define LOCKOUT_TIME    30   /* seconds */
 #define UNLOCK_TIMEOUT  60   /* seconds */
+#define MESSAGE_TIME    2000 /* ms */
 
 /* States */
 #define STATE_LOCKED    0
 #define STATE_UNLOCKED  1
 #define STATE_LOCKOUT   2
 #define STATE_CHANGE    3
+#define STATE_CONFIRM   4
+#define STATE_MESSAGE   5   /* Timed message, then msg_next_state */
 
-/* Keypad layout */
-__code char KEYMAP[4][4] = {
-    {'1', '2', '3', 'A'},
-    {'4', '5', '6', 'B'},
-    {'7', '8', '9', 'C'},
-    {'*', '0', '#', 'D'}
-};
+/* Buzzer patterns: alternating on/off times in 10ms units, 0 = end */
+__code unsigned char BEEP_SHORT[]   = {5, 0};
+__code unsigned char BEEP_SUCCESS[] = {10, 5, 10, 0};
+__code unsigned char BEEP_ERROR[]   = {50, 0};
 
 /* ========== Global Variables ========== */
 
 char password[PASSWORD_LEN + 1] = "1234";  /* Default password */
 char input[PASSWORD_LEN + 1];
+char new_pass[PASSWORD_LEN + 1];
 unsigned char input_pos = 0;
-unsigned char current_state = STATE_LOCKED;
+unsigned char current_state = STATE_MESSAGE;
+unsigned char msg_next_state = STATE_LOCKED;
 unsigned char wrong_attempts = 0;
-unsigned int lockout_counter = 0;
+unsigned char lockout_remaining = 0;
 unsigned int unlock_counter = 0;
 
-/* ========== Delay Functions ========== */
-
-void delay_us(unsigned int us)
-{
-    while (us--);
-}
-
-void delay_ms(unsigned int ms)
-{
-    unsigned int i, j;
-    for (i = 0; i < ms; i++)
-        for (j = 0; j < 120; j++);
-}
-
-/* ========== LCD Functions ========== */
-
-void lcd_nibble(unsigned char nibble)
-{
-    LCD_DATA = (LCD_DATA & 0x0F) | (nibble & 0xF0);
-    LCD_EN = 1;
-    delay_us(1);
-    LCD_EN = 0;
-    delay_us(50);
-}
-
-void lcd_cmd(unsigned char cmd)
-{
-    LCD_RS = 0;
-    lcd_nibble(cmd);
-    lcd_nibble(cmd << 4);
-    if (cmd == 0x01 || cmd == 0x02) delay_ms(2);
-}
-
-void lcd_data(unsigned char dat)
-{
-    LCD_RS = 1;
-    lcd_nibble(dat);
-    lcd_nibble(dat << 4);
-}
-
-void lcd_puts(char *str)
-{
-    while (*str) lcd_data(*str++);
-}
-
-void lcd_goto(unsigned char row, unsigned char col)
-{
-    lcd_cmd((row == 0 ? 0x80 : 0xC0) + col);
-}
-
-void lcd_clear(void)
-{
-    lcd_cmd(0x01);
-}
-
-void lcd_init(void)
-{
-    delay_ms(20);
-    LCD_RS = 0;
-    LCD_EN = 0;
-    lcd_nibble(0x30); delay_ms(5);
-    lcd_nibble(0x30); delay_us(150);
-    lcd_nibble(0x30); delay_us(150);
-    lcd_nibble(0x20); delay_us(150);
-    lcd_cmd(0x28);  /* 4-bit, 2 line */
-    lcd_cmd(0x0C);  /* Display on, cursor off */
-    lcd_cmd(0x06);  /* Increment */
-    lcd_cmd(0x01);  /* Clear */
-}
-
-void lcd_putnum(unsigned char num)
-{
-    if (num >= 10) lcd_data('0' + num / 10);
-    lcd_data('0' + num % 10);
-}
-
-/* ========== Keypad Functions ========== */
-
-char keypad_scan(void)
-{
-    unsigned char row;
-    char key = 0;
-
-    for (row = 0; row < 4; row++) {
-        KEYPAD_PORT = ~(1 << row);
-        delay_us(10);
-
-        if ((KEYPAD_PORT & 0x10) == 0) { key = KEYMAP[row][0]; break; }
-        if ((KEYPAD_PORT & 0x20) == 0) { key = KEYMAP[row][1]; break; }
-        if ((KEYPAD_PORT & 0x40) == 0) { key = KEYMAP[row][2]; break; }
-        if ((KEYPAD_PORT & 0x80) == 0) { key = KEYMAP[row][3]; break; }
-    }
-
-    KEYPAD_PORT = 0xFF;
-    return key;
-}
-
-char keypad_getkey(void)
-{
-    char key1, key2;
-
-    do { key1 = keypad_scan(); } while (key1 == 0);
-    delay_ms(20);
-    key2 = keypad_scan();
-    if (key1 != key2) return 0;
-    while (keypad_scan() != 0);
-    delay_ms(20);
-
-    return key1;
-}
-
-char keypad_getkey_timeout(unsigned int timeout_ms)
-{
-    char key;
-    unsigned int elapsed = 0;
-
-    while (elapsed < timeout_ms) {
-        key = keypad_scan();
-        if (key != 0) {
-            delay_ms(20);
-            if (keypad_scan() == key) {
-                while (keypad_scan() != 0);
-                return key;
-            }
-        }
-        delay_ms(10);
-        elapsed += 10;
-    }
-
-    return 0;  /* Timeout */
-}
+/* Buzzer task */
+__code unsigned char *beep_step = 0;
 
 /* ========== Sound Functions ========== */
 
-void beep_short(void)
+/* Start a buzzer pattern (replaces any pattern still playing) */
+void beep(__code unsigned char *pattern)
 {
-    BUZZER = 1;
-    delay_ms(50);
     BUZZER = 0;
+    beep_step = pattern;
+    sched_cancel(TASK_BUZZER);
+    sched_signal(TASK_BUZZER);
 }
 
-void beep_success(void)
-{
-    BUZZER = 1; delay_ms(100);
-    BUZZER = 0; delay_ms(50);
-    BUZZER = 1; delay_ms(100);
-    BUZZER = 0;
-}
-
-void beep_error(void)
-{
-    BUZZER = 1; delay_ms(500);
-    BUZZER = 0;
-}
+#define beep_short()    beep(BEEP_SHORT)
+#define beep_success()  beep(BEEP_SUCCESS)
+#define beep_error()    beep(BEEP_ERROR)
 
 /* ========== Lock Functions ========== */
 
@@ -295,165 +171,141 @@ void show_wrong_password(void)
     lcd_puts(" tries left");
 }
 
-void handle_locked_state(void)
+/* Show a screen for MESSAGE_TIME, then enter next_state */
+void show_message(unsigned char next_state)
 {
-    char key;
+    msg_next_state = next_state;
+    current_state = STATE_MESSAGE;
+    sched_defer(TASK_UI, MESSAGE_TIME);
+}
 
-    show_locked_screen();
-    clear_input();
+void enter_state(unsigned char state)
+{
+    current_state = state;
 
-    while (current_state == STATE_LOCKED) {
-        key = keypad_getkey();
+    switch (state) {
+        case STATE_LOCKED:
+            lock_close();
+            clear_input();
+            show_locked_screen();
+            break;
+
+        case STATE_UNLOCKED:
+            lock_open();
+            unlock_counter = 0;
+            sched_cancel(TASK_SECOND);  /* Count whole seconds from now */
+            show_unlocked_screen();
+            break;
+
+        case STATE_LOCKOUT:
+            lock_close();
+            lockout_remaining = LOCKOUT_TIME;
+            sched_cancel(TASK_SECOND);
+            show_lockout_screen(lockout_remaining);
+            break;
+
+        case STATE_CHANGE:
+            lock_close();
+            clear_input();
+            lcd_clear();
+            lcd_goto(0, 0);
+            lcd_puts("NEW PASSWORD:");
+            break;
 
-        if (key >= '0' && key <= '9') {
-            if (input_pos < PASSWORD_LEN) {
-                input[input_pos++] = key;
-                beep_short();
-                show_input_masked();
-            }
-        }
-        else if (key == 'B') {  /* Backspace */
-            if (input_pos > 0) {
-                input_pos--;
-                input[input_pos] = 0;
-                beep_short();
-                show_input_masked();
-            }
-        }
-        else if (key == 'C') {  /* Clear */
+        case STATE_CONFIRM:
             clear_input();
-            beep_short();
-            show_input_masked();
-        }
-        else if (key == '#') {  /* Enter */
-            if (input_pos == PASSWORD_LEN) {
-                if (check_password()) {
-                    beep_success();
-                    wrong_attempts = 0;
-                    current_state = STATE_UNLOCKED;
-                } else {
-                    beep_error();
-                    wrong_attempts++;
-                    if (wrong_attempts >= MAX_ATTEMPTS) {
-                        current_state = STATE_LOCKOUT;
-                    } else {
-                        show_wrong_password();
-                        delay_ms(2000);
-                        show_locked_screen();
-                        clear_input();
-                    }
-                }
-            }
-        }
-        else if (key == '*') {  /* Change password (only if unlocked first) */
-            /* Ignored in locked state */
-        }
+            lcd_clear();
+            lcd_goto(0, 0);
+            lcd_puts("CONFIRM:");
+            break;
     }
 }
 
-void handle_unlocked_state(void)
+/* Append a digit to the masked input; returns 1 when input is full */
+unsigned char add_digit(char key)
 {
-    char key;
-
-    lock_open();
-    show_unlocked_screen();
-    unlock_counter = 0;
-
-    while (current_state == STATE_UNLOCKED) {
-        key = keypad_getkey_timeout(1000);
+    if (input_pos < PASSWORD_LEN) {
+        input[input_pos++] = key;
+        beep_short();
+        show_input_masked();
+    }
+    return input_pos == PASSWORD_LEN;
+}
 
-        if (key == 'D') {  /* Manual lock */
-            current_state = STATE_LOCKED;
-        }
-        else if (key == '*') {  /* Change password */
-            current_state = STATE_CHANGE;
+void handle_locked_key(char key)
+{
+    if (key >= '0' && key <= '9') {
+        add_digit(key);
+    }
+    else if (key == 'B') {  /* Backspace */
+        if (input_pos > 0) {
+            input_pos--;
+            input[input_pos] = 0;
+            beep_short();
+            show_input_masked();
         }
-        else if (key == 0) {
-            /* Timeout - check auto-lock */
-            unlock_counter++;
-            if (unlock_counter >= UNLOCK_TIMEOUT) {
-                current_state = STATE_LOCKED;
+    }
+    else if (key == 'C') {  /* Clear */
+        clear_input();
+        beep_short();
+        show_input_masked();
+    }
+    else if (key == '#') {  /* Enter */
+        if (input_pos == PASSWORD_LEN) {
+            if (check_password()) {
+                beep_success();
+                wrong_attempts = 0;
+                enter_state(STATE_UNLOCKED);
+            } else {
+                beep_error();
+                wrong_attempts++;
+                if (wrong_attempts >= MAX_ATTEMPTS) {
+                    enter_state(STATE_LOCKOUT);
+                } else {
+                    show_wrong_password();
+                    show_message(STATE_LOCKED);
+                }
             }
         }
     }
-
-    lock_close();
+    /* '*' (change password) is ignored in locked state */
 }
 
-void handle_lockout_state(void)
+void handle_unlocked_key(char key)
 {
-    unsigned char remaining = LOCKOUT_TIME;
-
-    lock_close();
-
-    while (remaining > 0) {
-        show_lockout_screen(remaining);
-        delay_ms(1000);
-        remaining--;
+    if (key == 'D') {  /* Manual lock */
+        enter_state(STATE_LOCKED);
+    }
+    else if (key == '*') {  /* Change password */
+        enter_state(STATE_CHANGE);
     }
-
-    wrong_attempts = 0;
-    current_state = STATE_LOCKED;
 }
 
-void handle_change_password(void)
+void handle_change_key(char key)
 {
-    char key;
-    char new_pass[PASSWORD_LEN + 1];
-    char confirm[PASSWORD_LEN + 1];
-    unsigned char i, pos;
-
-    /* Get new password */
-    lcd_clear();
-    lcd_goto(0, 0);
-    lcd_puts("NEW PASSWORD:");
-    pos = 0;
+    unsigned char i;
 
-    while (pos < PASSWORD_LEN) {
-        key = keypad_getkey();
-        if (key >= '0' && key <= '9') {
-            new_pass[pos++] = key;
-            beep_short();
-            lcd_goto(1, 0);
-            for (i = 0; i < pos; i++) lcd_data('*');
-        }
-        else if (key == 'C') {
-            current_state = STATE_UNLOCKED;
-            return;
-        }
+    if (key == 'C') {
+        enter_state(STATE_UNLOCKED);
+        return;
     }
-    new_pass[PASSWORD_LEN] = 0;
+    if (key < '0' || key > '9') return;
+    if (!add_digit(key)) return;
 
-    /* Confirm password */
-    lcd_clear();
-    lcd_goto(0, 0);
-    lcd_puts("CONFIRM:");
-    pos = 0;
-
-    while (pos < PASSWORD_LEN) {
-        key = keypad_getkey();
-        if (key >= '0' && key <= '9') {
-            confirm[pos++] = key;
-            beep_short();
-            lcd_goto(1, 0);
-            for (i = 0; i < pos; i++) lcd_data('*');
-        }
-        else if (key == 'C') {
-            current_state = STATE_UNLOCKED;
-            return;
-        }
+    if (current_state == STATE_CHANGE) {
+        for (i = 0; i <= PASSWORD_LEN; i++) new_pass[i] = input[i];
+        enter_state(STATE_CONFIRM);
+        return;
     }
-    confirm[PASSWORD_LEN] = 0;
 
     /* Check match */
     for (i = 0; i < PASSWORD_LEN; i++) {
-        if (new_pass[i] != confirm[i]) {
+        if (new_pass[i] != input[i]) {
             lcd_clear();
             lcd_goto(0, 0);
             lcd_puts("NO MATCH!");
             beep_error();
-            delay_ms(2000);
-            current_state = STATE_UNLOCKED;
+            show_message(STATE_UNLOCKED);
             return;
         }
     }
@@ -469,47 +321,114 @@ void handle_change_password(void)
     lcd_goto(1, 0);
     lcd_puts("CHANGED!");
     beep_success();
-    delay_ms(2000);
+    show_message(STATE_UNLOCKED);
+}
+
+/* ========== Tasks ========== */
+
+/*
+ * UI task (on keypad event or message timeout)
+ * Takes one event per run and runs again while more are queued.
+ */
+void task_ui(void)
+{
+    unsigned char e = keypad_get();
+    char key = 0;
+
+    if (KEYPAD_TYPE(e) == KEYPAD_PRESS) key = keypad_char(e);
+    if (keypad_pending()) sched_signal(TASK_UI);
+
+    switch (current_state) {
+        case STATE_LOCKED:
+            if (key) handle_locked_key(key);
+            break;
+        case STATE_UNLOCKED:
+            if (key) handle_unlocked_key(key);
+            break;
+        case STATE_CHANGE:
+        case STATE_CONFIRM:
+            if (key) handle_change_key(key);
+            break;
+        case STATE_MESSAGE:
+            if (!sched_signalled) enter_state(msg_next_state);
+            break;
+        /* STATE_LOCKOUT: keys ignored, task_second ends it */
+    }
+}
+
+/*
+ * One-second task: lockout countdown and auto-lock timeout
+ */
+void task_second(void)
+{
+    if (current_state == STATE_LOCKOUT) {
+        lockout_remaining--;
+        if (lockout_remaining == 0) {
+            wrong_attempts = 0;
+            enter_state(STATE_LOCKED);
+        } else {
+            show_lockout_screen(lockout_remaining);
+        }
+    }
+    else if (current_state == STATE_UNLOCKED) {
+        unlock_counter++;
+        if (unlock_counter >= UNLOCK_TIMEOUT) {
+            enter_state(STATE_LOCKED);
+        }
+    }
+}
+
+/*
+ * Buzzer task: steps through the active pattern, one step per run
+ */
+void task_buzzer(void)
+{
+    unsigned char step;
+
+    if (beep_step == 0) return;
+
+    step = *beep_step;
+    if (step == 0) {
+        BUZZER = 0;
+        beep_step = 0;
+        return;
+    }
 
-    current_state = STATE_UNLOCKED;
+    beep_step++;
+    BUZZER = !BUZZER;
+    sched_defer(TASK_BUZZER, step * 10);
 }
 
+__code sched_task_t sched_tasks[SCHED_NUM_TASKS] = {
+    {task_ui, 0},           /* TASK_UI */
+    {task_second, 1000},    /* TASK_SECOND */
+    {task_buzzer, 0}        /* TASK_BUZZER */
+};
+
 /* ========== Main ========== */
 
 void main(void)
 {
     /* Initialize hardware */
-    KEYPAD_PORT = 0xFF;
     RELAY = 0;
     BUZZER = 0;
     LED_GREEN = 1;
     LED_RED = 0;
 
     lcd_init();
+    systick_init();
+    sched_init();
+    keypad_init();
 
     /* Startup message */
     lcd_goto(0, 2);
     lcd_puts("PASSWORD");
     lcd_goto(1, 4);
     lcd_puts("LOCK");
-    delay_ms(2000);
-
-    current_state = STATE_LOCKED;
+    show_message(STATE_LOCKED);
 
+    /* Every task makes progress; none of them blocks */
     while (1) {
-        switch (current_state) {
-            case STATE_LOCKED:
-                handle_locked_state();
-                break;
-            case STATE_UNLOCKED:
-                handle_unlocked_state();
-                break;
-            case STATE_LOCKOUT:
-                handle_lockout_state();
-                break;
-            case STATE_CHANGE:
-                handle_change_password();
-                break;
-        }
+        sched_run();
     }
 }
@@ -23,8 +23,11 @@
 #include <8052.h>
 
 /* Timing Configuration */
-#define DELAY_OUTER_LOOP    50
-#define DELAY_INNER_LOOP    1275
+#define F_CPU               12000000UL
+#define SYSTICK_NUM_TIMERS  0
+#include "../../../Bootcamp/lib/systick.h"
+
+#define STEP_MS             1000
 
 /* Traffic Light States (P0/P1 patterns) */
 #define ROAD1_GREEN_ROAD2_RED    0x44
@@ -56,13 +59,14 @@ __code unsigned char TRAFFIC_SEQUENCE[][2] = {
     {ROAD1_RED_ROAD2_GREEN,   ROAD1_RED_ROAD2_YELLOW}
 };
 
-/* Generate approximately 1 second delay at 12MHz */
+/* Next countdown step (absolute, so steps never accumulate drift) */
+systick_t next_step;
+
+/* Wait for the next 1 second step boundary */
 void delay_1sec(void)
 {
-    unsigned int i, j;
-    for (i = 0; i < DELAY_OUTER_LOOP; i++) {
-        for (j = 0; j < DELAY_INNER_LOOP; j++);
-    }
+    next_step += STEP_MS;
+    while (!systick_expired(next_step));
 }
 
 /* Display countdown on seven-segment displays */
@@ -88,6 +92,9 @@ void main(void)
     /* Initialize all ports */
     P0 = P1 = P2 = P3 = 0x00;
 
+    systick_init();
+    next_step = millis();
+
     while (1) {
         for (state = 0; state < NUM_STATES; state++) {
             P0 = TRAFFIC_SEQUENCE[state][0];
@@ -0,0 +1,45 @@
+/*
+ * clock_bench.c - Main loop rate of Projects/Digital_Clock
+ * 8051 Bootcamp Tests
+ *
+ * Builds the clock with BENCH_LOOP (add -DBENCH_OLD_PATH for the
+ * previous display path) and records the main loop passes counted in
+ * each of seconds 2-4 of simulated time; the first second is skipped
+ * as it includes the start-up. The clock's own Timer 0/1/2 interrupts
+ * all run, as on the board, with no buttons pressed.
+ *
+ * The clock owns Timer 2, so sim_init() and the stopwatch are not used:
+ * the counts are only recorded.
+ */
+
+#include "sim.h"
+
+#define BENCH_LOOP
+#define BENCH_REPORT(n)     bench_report(n)
+void bench_report(unsigned int passes);
+
+#define main clock_main
+#include "../../Projects/Digital_Clock/src/main.c"
+#undef main
+
+static unsigned char bench_seconds;
+
+/* sim 1: passes in second 2 */
+/* sim 2: passes in second 3 */
+/* sim 3: passes in second 4 */
+void bench_report(unsigned int passes)
+{
+    if (bench_seconds++ == 0) return;
+    sim_report(bench_seconds - 1, passes);
+    if (bench_seconds == 4) {
+        EA = 0;
+        sim_done();
+    }
+}
+
+void main(void)
+{
+    sim_count = 0;
+    bench_seconds = 0;
+    clock_main();
+}
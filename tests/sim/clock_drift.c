@@ -0,0 +1,43 @@
+/*
+ * clock_drift.c - Timekeeping of Projects/Digital_Clock
+ * 8051 Bootcamp Tests
+ *
+ * Starts the clock's Timer 2 tick with CLOCK_TRIM_PPM and waits until
+ * it has counted SIM_SECONDS seconds; run with --clocks, the simulated
+ * time this took is compared with the cycle-exact model by
+ * Projects/Digital_Clock/tools/trim_model.py --s51 SECONDS.
+ *
+ * Only the tick runs (no display or buttons), so the one thing timed is
+ * timer2_isr() and its trim. The clock owns Timer 2: sim_init() and the
+ * stopwatch are not used.
+ */
+
+#include "sim.h"
+
+#ifndef SIM_SECONDS
+#define SIM_SECONDS     60
+#endif
+
+#define main clock_main
+#include "../../Projects/Digital_Clock/src/main.c"
+#undef main
+
+void main(void)
+{
+    unsigned int s = 0;
+
+    sim_count = 0;
+    timer_init();               /* trim_apply(CLOCK_TRIM_PPM), starts Timer 2 */
+
+    while (s < SIM_SECONDS) {
+        if (second_flag) {
+            second_flag = 0;
+            s++;
+        }
+    }
+    EA = 0;
+
+    /* sim 1: seconds counted */
+    sim_report(1, s);
+    sim_done();
+}
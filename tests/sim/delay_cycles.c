@@ -0,0 +1,60 @@
+/*
+ * delay_cycles.c - Cycle counts of lib/delay.h
+ * 8051 Bootcamp Tests
+ *
+ * Times delay_us(), delay_ms() and delay_ms_sw() with Timer 2 and
+ * checks them against the F_CPU they were built for. Run once per
+ * supported crystal (make delay):
+ *   delay_us():  6 + 2n cycles, within 2 of the nominal count
+ *                (8 cycles minimum)
+ *   delay_ms():  within 2% (the per-millisecond reload is not
+ *                compensated), delay_ms_sw() within 3%
+ */
+
+#include "sim.h"
+#include "delay.h"
+
+/* Nominal machine cycles for a delay_us() constant */
+#define US_EXPECT(us) \
+    (DELAY_US_CYCLES(us) < DELAY_LOOP_OVERHEAD + 2 ? \
+     DELAY_LOOP_OVERHEAD + 2 : DELAY_US_CYCLES(us))
+
+#define US_CASE(id, us) do { \
+        sim_start(); \
+        delay_us(us); \
+        sim_check(id, US_EXPECT(us), sim_stop(), 2); \
+    } while (0)
+
+#define MS_EXPECT(ms)   ((unsigned long)(ms) * F_CPU / 12000UL)
+
+void main(void)
+{
+    unsigned long c;
+
+    sim_init();
+
+    US_CASE(1, 1);              /* sim 1: delay_us(1) */
+    US_CASE(2, 5);              /* sim 2: delay_us(5) */
+    US_CASE(3, 10);             /* sim 3: delay_us(10) */
+    US_CASE(4, 50);             /* sim 4: delay_us(50) */
+    US_CASE(5, 100);            /* sim 5: delay_us(100) */
+    US_CASE(6, 150);            /* sim 6: delay_us(150) */
+    US_CASE(7, DELAY_US_MAX);   /* sim 7: delay_us(DELAY_US_MAX) */
+
+    sim_start();
+    delay_ms(1);
+    c = sim_stop();
+    sim_check(10, MS_EXPECT(1), c, MS_EXPECT(1) / 50);     /* sim 10: delay_ms(1) */
+
+    sim_start();
+    delay_ms(10);
+    c = sim_stop();
+    sim_check(11, MS_EXPECT(10), c, MS_EXPECT(10) / 50);   /* sim 11: delay_ms(10) */
+
+    sim_start();
+    delay_ms_sw(10);
+    c = sim_stop();
+    sim_check(12, MS_EXPECT(10), c, MS_EXPECT(10) * 3 / 100); /* sim 12: delay_ms_sw(10) */
+
+    sim_done();
+}
@@ -0,0 +1,77 @@
+/*
+ * lcdq_isr.c - Tick length of lib/lcdq.h
+ * 8051 Bootcamp Tests
+ *
+ * The lcdq.h ISR runs every LCDQ_TICK_US while cells are dirty, so its
+ * longest path decides how much CPU the background refresh takes, and
+ * it must end well before the next tick. Each kind of tick is set up by
+ * hand and run once by setting TF0 (Timer 0 itself is left stopped);
+ * the cycles include the interrupt call and return. All must be below
+ * the tick, and the longest one is reported.
+ *
+ * No LCD is attached: the port writes go nowhere, which costs the same.
+ */
+
+#include "sim.h"
+#include "lcdq.h"
+
+static unsigned long worst;
+
+/* Run the ISR once, as the timer would */
+static unsigned long tick(void)
+{
+    unsigned long c;
+
+    sim_start();
+    TF0 = 1;
+    c = sim_stop();
+    if (c > worst) worst = c;
+    return c;
+}
+
+/* Dirty map of one pattern byte, scan and cursor at cell 0 */
+static void setup(unsigned char dirty, unsigned char cursor_col)
+{
+    unsigned char i;
+
+    for (i = 0; i < _LCDFB_DBYTES; i++)
+        lcdfb_dirty[i] = dirty;
+    lcdfb_changed = dirty != 0;
+    _lcdq_i = _lcdq_row = _lcdq_col = 0;
+    _lcdq_left = LCDFB_SIZE;
+    _lcdfb_row = 0;
+    _lcdfb_col = cursor_col;
+}
+
+void main(void)
+{
+    sim_init();
+    lcdfb_init();
+    lcdq_init();                /* Nothing dirty: Timer 0 stays off */
+    worst = 0;
+
+    /* sim 1: idle lap, screen clean (stops the timer) */
+    setup(0, 0);
+    sim_below(1, _LCDQ_CYCLES, tick());
+
+    /* sim 2: LCDQ_SCAN clean cells, nothing found yet */
+    setup(0x80, 0);
+    sim_below(2, _LCDQ_CYCLES, tick());
+
+    /* sim 3: cursor move to a dirty cell */
+    setup(0x01, LCD_COLS - 1);
+    sim_below(3, _LCDQ_CYCLES, tick());
+
+    /* sim 4: character under the cursor */
+    setup(0x01, 0);
+    sim_below(4, _LCDQ_CYCLES, tick());
+
+    /* sim 5: LCDQ_SCAN - 1 clean cells, then a character */
+    setup(1 << ((LCDQ_SCAN - 1) & 7), (LCDQ_SCAN - 1) & 7);
+    sim_below(5, _LCDQ_CYCLES, tick());
+
+    /* sim 6: longest tick, cycles */
+    sim_report(6, worst);
+
+    sim_done();
+}
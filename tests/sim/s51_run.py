@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""
+s51_run.py - Build a test program with SDCC and run it in s51 (ucsim)
+
+The program uses tests/sim/sim.h: it records results in XRAM and calls
+sim_done(). This script builds it, runs s51 to a breakpoint on
+sim_done(), dumps the records and prints them. Exit status is 1 if a
+check failed, the program never reached sim_done(), or nothing was
+recorded.
+
+    python3 s51_run.py delay_cycles.c
+    python3 s51_run.py -DF_CPU=24000000UL delay_cycles.c
+    python3 s51_run.py --clocks -DSIM_SECONDS=60 -DCLOCK_TRIM_PPM=20 clock_drift.c
+
+Record labels come from comments in the source of the form
+    /* sim 3: delay_us(100) */
+
+Needs sdcc and s51 on the PATH (SDCC's ucsim package); set SDCC or S51
+to use other binaries.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+LIB = os.path.normpath(os.path.join(HERE, "..", "..", "Bootcamp", "lib"))
+
+REC_SIZE = 10
+MAX_RECS = 32
+STATUS = {0: "FAIL", 1: "ok", 2: "info"}
+
+
+def fcpu_of(defines):
+    for d in defines:
+        m = re.match(r"F_CPU=(\d+)", d)
+        if m:
+            return int(m.group(1))
+    return 11059200
+
+
+def build(src, defines, outdir):
+    name = os.path.splitext(os.path.basename(src))[0]
+    os.makedirs(outdir, exist_ok=True)
+    ihx = os.path.join(outdir, name + ".ihx")
+    cmd = [os.environ.get("SDCC", "sdcc"), "-mmcs51", "-I" + HERE, "-I" + LIB]
+    cmd += ["-D" + d for d in defines]
+    cmd += [src, "-o", ihx]
+    subprocess.run(cmd, check=True)
+    return ihx, os.path.join(outdir, name + ".map")
+
+
+def symbol(mapfile, sym):
+    with open(mapfile) as f:
+        for line in f:
+            m = re.search(r"\b([0-9A-Fa-f]{4,8})\s+" + re.escape(sym) + r"\b", line)
+            if m:
+                return int(m.group(1), 16)
+    sys.exit("%s: %s not found (does the program call sim_done()?)" % (mapfile, sym))
+
+
+def run_s51(ihx, fcpu, done, timeout, dump_cmd):
+    end = 1 + REC_SIZE * MAX_RECS
+    script = "\n".join([
+        "break 0x%04x" % done,
+        "run",
+        "state",
+        dump_cmd % (0, end),
+        "quit",
+        "",
+    ])
+    cmd = [os.environ.get("S51", "s51"), "-t", "8052", "-X", str(fcpu), ihx]
+    p = subprocess.run(cmd, input=script, capture_output=True, text=True,
+                       timeout=timeout)
+    return p.stdout + p.stderr
+
+
+def parse_dump(out):
+    mem = {}
+    for line in out.splitlines():
+        m = re.match(r"^(?:\d+>\s*)?\s*(?:0x)?([0-9a-fA-F]{4,8})\s+((?:[0-9a-fA-F]{2}\s+)+)",
+                     line + " ")
+        if not m:
+            continue
+        addr = int(m.group(1), 16)
+        for i, b in enumerate(m.group(2).split()):
+            mem[addr + i] = int(b, 16)
+    return mem
+
+
+def labels_of(src):
+    with open(src) as f:
+        text = f.read()
+    return {int(i): t.strip() for i, t in
+            re.findall(r"/\*\s*sim\s+(\d+):\s*(.*?)\s*\*/", text)}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    ap.add_argument("src")
+    ap.add_argument("-D", dest="defines", action="append", default=[])
+    ap.add_argument("--clocks", action="store_true",
+                    help="also print the simulated clocks to sim_done()")
+    ap.add_argument("--timeout", type=int, default=1800,
+                    help="seconds of host time allowed for s51")
+    args = ap.parse_args()
+
+    fcpu = fcpu_of(args.defines)
+    tag = "-".join(re.sub(r"\W", "_", d) for d in args.defines) or "default"
+    outdir = os.path.join(HERE, "build", tag)
+    ihx, mapfile = build(args.src, args.defines, outdir)
+    done = symbol(mapfile, "_sim_done")
+
+    out = run_s51(ihx, fcpu, done, args.timeout, "dump xram 0x%04x 0x%04x 16")
+    mem = parse_dump(out)
+    if 0 not in mem:                        # Older ucsim: dx start stop
+        out = run_s51(ihx, fcpu, done, args.timeout, "dx 0x%04x 0x%04x")
+        mem = parse_dump(out)
+
+    clocks = re.search(r"\((\d+)\s*clks\)", out)
+    if 0 not in mem or not clocks:
+        sys.stdout.write(out)
+        sys.exit("%s: s51 did not reach sim_done()" % args.src)
+
+    labels = labels_of(args.src)
+    count = min(mem[0], MAX_RECS)
+    failed = count == 0
+    print("%s  F_CPU=%d" % (os.path.basename(args.src), fcpu))
+    for n in range(count):
+        base = 1 + n * REC_SIZE
+        rec = bytes(mem.get(base + i, 0) for i in range(REC_SIZE))
+        rid, status = rec[0], rec[1]
+        expect = int.from_bytes(rec[2:6], "little")
+        got = int.from_bytes(rec[6:10], "little")
+        failed |= status == 0
+        label = labels.get(rid, "")
+        if status == 2:
+            print("  %3d %-4s %10d        %s" % (rid, STATUS[status], got, label))
+        else:
+            print("  %3d %-4s %10d / %-10d %s" % (rid, STATUS.get(status, "?"),
+                                                got, expect, label))
+    if args.clocks:
+        c = int(clocks.group(1))
+        print("  clocks %d (%.6f s)" % (c, c / float(fcpu)))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+/*
+ * sim.h - Helpers for test programs run in the s51 simulator
+ * 8051 Bootcamp Tests
+ *
+ * A test program times code with Timer 2 (machine cycles, reset to 0
+ * before each measurement), records the results in XRAM and calls
+ * sim_done(). s51_run.py builds it, runs it to sim_done() in s51 and
+ * prints the records.
+ *
+ * Usage:
+ *   #include "sim.h"
+ *   sim_init();
+ *   sim_start(); code(); c = sim_stop();
+ *   sim_check(id, expected, c, tolerance);     Pass/fail record
+ *   sim_below(id, limit, c);                   Pass if c < limit
+ *   sim_report(id, c);                         Measurement only
+ *   sim_done();
+ *
+ * Timer 2 is the stopwatch, so code under test must not use it. One
+ * measurement can be at most 65535 cycles; longer ones record
+ * SIM_OVERFLOW and fail.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <8052.h>
+
+#define SIM_MAX         32
+#define SIM_OVERFLOW    0xFFFFFFFFUL
+
+#define SIM_FAIL        0
+#define SIM_PASS        1
+#define SIM_INFO        2
+
+/* Record layout read by s51_run.py: 10 bytes, little-endian */
+typedef struct {
+    unsigned char id;
+    unsigned char status;       /* SIM_FAIL, SIM_PASS or SIM_INFO */
+    unsigned long expect;
+    unsigned long got;
+} sim_rec_t;
+
+__xdata __at (0x0000) unsigned char sim_count;
+__xdata __at (0x0001) sim_rec_t sim_rec[SIM_MAX];
+
+/* Cycles sim_start() + sim_stop() add to every measurement */
+static unsigned int _sim_overhead;
+
+/* Reset and start the stopwatch */
+#define sim_start() do { \
+        TR2 = 0; TF2 = 0; TH2 = 0; TL2 = 0; TR2 = 1; \
+    } while (0)
+
+/*
+ * Stop the stopwatch
+ *
+ * @return: Machine cycles since sim_start(), SIM_OVERFLOW if > 65535
+ */
+unsigned long sim_stop(void)
+{
+    unsigned int c;
+
+    TR2 = 0;
+    if (TF2) return SIM_OVERFLOW;
+    c = ((unsigned int)TH2 << 8) | TL2;
+    return c - _sim_overhead;
+}
+
+/*
+ * Set up Timer 2 and measure the stopwatch's own cost
+ */
+void sim_init(void)
+{
+    EA = 0;
+    T2CON = 0x00;               /* 16-bit auto-reload from 0, no capture */
+    RCAP2H = 0;
+    RCAP2L = 0;
+    sim_count = 0;
+    _sim_overhead = 0;
+    sim_start();
+    _sim_overhead = sim_stop();
+}
+
+static void _sim_add(unsigned char id, unsigned char status,
+                     unsigned long expect, unsigned long got)
+{
+    unsigned char n = sim_count;
+
+    if (n >= SIM_MAX) return;
+    sim_rec[n].id = id;
+    sim_rec[n].status = status;
+    sim_rec[n].expect = expect;
+    sim_rec[n].got = got;
+    sim_count = n + 1;
+}
+
+/*
+ * Record a measurement that must be within tol of expect
+ *
+ * @param id: Test number, shown by s51_run.py
+ * @param expect: Expected value
+ * @param got: Measured value
+ * @param tol: Allowed difference either way
+ */
+void sim_check(unsigned char id, unsigned long expect, unsigned long got,
+               unsigned long tol)
+{
+    unsigned long d = got > expect ? got - expect : expect - got;
+
+    _sim_add(id, got != SIM_OVERFLOW && d <= tol ? SIM_PASS : SIM_FAIL,
+             expect, got);
+}
+
+/*
+ * Record a measurement that must be below a limit (shown as expected)
+ *
+ * @param id: Test number
+ * @param limit: Smallest failing value
+ * @param got: Measured value
+ */
+void sim_below(unsigned char id, unsigned long limit, unsigned long got)
+{
+    _sim_add(id, got < limit ? SIM_PASS : SIM_FAIL, limit, got);
+}
+
+/*
+ * Record a measurement with no expected value (benchmarks)
+ */
+void sim_report(unsigned char id, unsigned long got)
+{
+    _sim_add(id, got == SIM_OVERFLOW ? SIM_FAIL : SIM_INFO, 0, got);
+}
+
+/*
+ * End of test: s51_run.py stops here and reads the records
+ */
+void sim_done(void)
+{
+    while (1);
+}
+
+#endif /* SIM_H */
@@ -0,0 +1,44 @@
+/*
+ * systick_t0.c - Timer 0 tick rate of lib/systick.h
+ * 8051 Bootcamp Tests
+ *
+ * With SYSTICK_TIMER 0 the ISR adds the period to the running count
+ * and makes up for the cycles the timer is stopped (SYSTICK_T0_FIXUP).
+ * A wrong fixup shows as one cycle per tick, so SPAN ticks are timed
+ * with Timer 2 and must match SPAN milliseconds of F_CPU to within the
+ * polling jitter at each end.
+ */
+
+#define SYSTICK_TIMER   0
+#include "sim.h"
+#include "systick.h"
+
+/* As many whole ms as fit in one 16-bit measurement */
+#define SPAN            (60000UL / SYSTICK_PERIOD)
+
+/* Wait for the next tick (the low byte is read atomically) */
+static void next_tick(void)
+{
+    unsigned char m = *(volatile unsigned char *)&systick_ms;
+
+    while (*(volatile unsigned char *)&systick_ms == m);
+}
+
+void main(void)
+{
+    unsigned char n;
+
+    sim_init();
+    systick_init();
+
+    next_tick();
+    next_tick();                /* Start on a tick edge */
+    sim_start();
+    for (n = SPAN; n; n--)
+        next_tick();
+
+    /* sim 1: SPAN ticks, cycles (+-12 for polling) */
+    sim_check(1, SPAN * F_CPU / 12000UL, sim_stop(), 12);
+
+    sim_done();
+}
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+tlm_decode.py - Decoder for Bootcamp/lib/telemetry.h frames
+
+Reads a raw byte capture (file argument or stdin), splits it on 0x00,
+COBS-decodes each frame, checks the CRC and sequence numbers and prints
+one line per frame. Exit status is 1 if any frame was bad or missing.
+
+    python3 tools/tlm_decode.py capture.bin
+    stty -F /dev/ttyUSB0 9600 raw; python3 tools/tlm_decode.py < /dev/ttyUSB0
+    python3 tools/tlm_decode.py --crc8 capture.bin    (firmware built with TLM_CRC8)
+"""
+
+import argparse
+import sys
+
+TLM_BATCH8 = 0x01
+TLM_BATCH16 = 0x02
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def crc8_smbus(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) if crc & 0x80 else (crc << 1)
+            crc &= 0xFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if i + code > len(data):
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        for b in chunk:
+            if b == 0:
+                if buf:
+                    yield bytes(buf)
+                buf = bytearray()
+            else:
+                buf.append(b)
+
+
+def describe(ftype, payload):
+    if ftype == TLM_BATCH8 and len(payload) >= 2:
+        ch, count = payload[0], payload[1]
+        samples = list(payload[2:2 + count])
+        return "BATCH8  ch=%d n=%d %s" % (ch, count, samples)
+    if ftype == TLM_BATCH16 and len(payload) >= 2:
+        ch, count = payload[0], payload[1]
+        raw = payload[2:2 + 2 * count]
+        samples = [raw[i] << 8 | raw[i + 1] for i in range(0, len(raw) - 1, 2)]
+        return "BATCH16 ch=%d n=%d %s" % (ch, count, samples)
+    return "TYPE%02X  %s" % (ftype, payload.hex())
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("file", nargs="?", help="capture file (default stdin)")
+    ap.add_argument("--crc8", action="store_true", help="frames use CRC-8")
+    args = ap.parse_args()
+
+    stream = open(args.file, "rb") if args.file else sys.stdin.buffer
+    crc_len = 1 if args.crc8 else 2
+
+    good = bad = lost = 0
+    expect = None
+
+    for raw in frames(stream):
+        try:
+            frame = cobs_decode(raw)
+        except ValueError as e:
+            print("error: %s" % e)
+            bad += 1
+            continue
+
+        if len(frame) < 2 + crc_len:
+            print("error: short frame (%d bytes)" % len(frame))
+            bad += 1
+            continue
+
+        body, tail = frame[:-crc_len], frame[-crc_len:]
+        if args.crc8:
+            ok = crc8_smbus(body) == tail[0]
+        else:
+            ok = crc16_ccitt(body) == (tail[0] << 8 | tail[1])
+        if not ok:
+            print("error: CRC mismatch, seq=%d" % body[1])
+            bad += 1
+            continue
+
+        ftype, seq, payload = body[0], body[1], body[2:]
+        if expect is not None and seq != expect:
+            gap = (seq - expect) & 0xFF
+            print("warning: %d frame(s) missing before seq=%d" % (gap, seq))
+            lost += gap
+        expect = (seq + 1) & 0xFF
+
+        print("seq=%3d %s" % (seq, describe(ftype, payload)))
+        good += 1
+
+    print("%d good, %d bad, %d missing" % (good, bad, lost), file=sys.stderr)
+    return 1 if bad or lost else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())